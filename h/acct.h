@@ -0,0 +1,27 @@
+#ifndef ACCT
+#define ACCT
+
+/************************* ACCT.H *****************************
+ *
+ *  The externals declaration file for the process accounting
+ *  module.
+ *
+ *  Keeps a record per terminated process in a RAM ring and writes
+ *  the ring out, one flash block at a time, to the reserved flash
+ *  device ACCTFLASHDEV.
+ *
+ */
+
+#include "../h/types.h"
+
+extern void acctRecord(pcb_PTR p, int reason);
+extern void acctTick();
+extern int acctInterrupt(int devNum, unsigned int status);
+extern void acctSync();
+
+extern unsigned int acctLost;
+extern unsigned int acctWritten;
+
+/******************************************************************/
+
+#endif
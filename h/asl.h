@@ -17,6 +17,9 @@ extern pcb_PTR outBlocked (pcb_PTR p);
 extern pcb_PTR headBlocked (int *semAdd);
 extern void initASL ();
 
+extern void countPasseren (int *semAdd);
+extern int getSemStats (semstat_t *buf, int n);
+
 /***************************************************************/
 
 #endif
@@ -27,9 +27,51 @@
 #define EOS				    '\0'
 
 #define NULL 			    ((void *)0xFFFFFFFF)
-#define MAXPROC 20          /* Maximum number of concurrent processes */
+#ifndef MAXPROC
+#define MAXPROC 20          /* Maximum number of concurrent processes (-DMAXPROC=n overrides) */
+#endif
 #define MAXINT 0x7FFFFFFF   /* Maximum positive integer for 32-bit systems */
 #define CLOCKINTERVAL 100000UL
+#ifndef SEMSTATSIZE
+#define SEMSTATSIZE 64      /* Semaphores tracked by the ASL contention profile (-DSEMSTATSIZE=n overrides) */
+#endif
+#ifndef WAITGRAPHSIZE
+#define WAITGRAPHSIZE 256   /* Wakeup records held by the wait-for graph recorder */
+#endif
+#ifndef PROFSIZE
+#define PROFSIZE 64         /* Functions tracked by the PROFILE build */
+#endif
+#define PROFDEPTH 32        /* Call depth followed by the PROFILE build */
+#define PROFDUMP 16         /* Functions printed by DUMPPROFILE */
+#define LOADPERIODS 3       /* Load averages over 1, 5 and 15 Interval Timer ticks */
+#define LOADFSHIFT 11       /* Fraction bits of the load averages */
+#define RQHISTBUCKETS 8     /* Power-of-two ready queue depth buckets */
+#define ACCTRINGSIZE 128    /* Accounting records buffered in RAM */
+#define ACCTFLUSHTICKS 10   /* Interval Timer ticks between accounting writes */
+#define ACCTFLASHDEV 7      /* Flash device reserved for accounting records */
+#define KLOGSIZE 2048       /* Kernel log ring in bytes, a power of two */
+#define KLOGTERM 7          /* Terminal reserved for the kernel log */
+/* Kernel pools tracked in poolStats[] */
+#define POOLPCB 0           /* pcb slab cache */
+#define POOLSEMD 1          /* semd slab cache */
+#define POOLSEMSTAT 2       /* ASL contention records */
+#define POOLACCT 3          /* Accounting record ring */
+#define POOLWAITGRAPH 4     /* Wait-for graph ring (WAITGRAPH builds) */
+#define POOLPAGES 5         /* Physical pages (palloc.c) */
+#define POOLPMAP 6          /* Pager frame mapping records */
+#define POOLSHM 7           /* Shared memory segments */
+#define POOLZPOOL 8         /* Compressed swap pool chunks */
+#define NUMPOOLS 9
+#ifndef MAXPAGES
+#define MAXPAGES 1024       /* Pages the page allocator can manage (-DMAXPAGES=n overrides) */
+#endif
+#define PAGEORDERS 11       /* Block orders: 1 to 1024 pages */
+#ifndef ROOTSTACKPAGES
+#define ROOTSTACKPAGES 16   /* Pages below RAMTOP left to the first process' stacks */
+#endif
+#ifndef QUANTUM
+#define QUANTUM 5000        /* PLT time slice in microseconds (-DQUANTUM=n overrides) */
+#endif
 
 /* Status Register Bit Masks */
 #define IEPBITON 0x4         /* Previous Interrupt Enable (bit 2) */
@@ -82,6 +124,15 @@
 /* device common COMMAND codes */
 #define RESET			    0
 #define ACK				    1
+
+/* terminal transmitter COMMAND and STATUS codes */
+#define PRINTCHR        2
+#define CHARTRANSMITTED 5
+#define BYTELEN         8   /* character shift in a transmit command */
+
+/* flash COMMAND codes */
+#define FLASHREADBLK    2
+#define FLASHWRITEBLK   3
 #define DEV_REG_ADDR(intLine, devNum) ((device_t *)(0x10000054 + ((intLine - 3) * 0x80) + (devNum * 0x10)))
 #define INTDEVBITMAP_ADDR(intLine) ((unsigned int *)(0x10000040 + ((intLine - 3) * 0x04)))
 
@@ -103,6 +154,46 @@
 #define	MIN(A,B)		((A) < (B) ? A : B)
 #define MAX(A,B)		((A) < (B) ? B : A)
 #define	ALIGNED(A)		(((unsigned)A & 0x3) == 0)
+#define PAGEALIGNED		__attribute__((aligned(PAGESIZE)))	/* page-aligned static data */
+
+/* Virtual memory: private page tables walked by the TLB-refill handler */
+#define USERPGTBLSIZE   32          /* pages per process: 31 text/data, 1 stack */
+#define VPNSHIFT        12
+#define VPNMASK         0xFFFFF000  /* EntryHi.VPN */
+#define ASIDSHIFT       6
+#define ASIDMASK        0x00000FC0  /* EntryHi.ASID */
+#define MAXASID         64          /* ASIDs; 0 is the nucleus' and unmapped processes' */
+#define USERSTACKVPN    0xBFFFF000  /* Stack page of a process, last page table entry */
+#define TLBPMISS        0x80000000  /* Index.P: TLBP found no entry */
+#define TLBMODEXC       1           /* Cause.ExcCode of a TLB-Modification exception */
+#define GLOBALON        0x00000100  /* EntryLo.G */
+#define VALIDON         0x00000200  /* EntryLo.V */
+#define DIRTYON         0x00000400  /* EntryLo.D: page writable */
+#define PFNMASK         0xFFFFF000  /* EntryLo.PFN */
+
+/* Demand paging (pager.c): software bits of EntryLo, ignored by the TLB */
+#define PTEPAGED        0x00000001  /* The nucleus pager manages the page */
+#define PTEWRITABLE     0x00000002  /* Writes allowed; D is set on the first one */
+#define PTEONFLASH      0x00000004  /* Not resident: PFN is the swap block holding the page */
+#define PTERESIDENT     0x00000008  /* PFN holds the page; V off samples references */
+#define PTECOW          0x00000010  /* Shared writable page: copy on the next write */
+#define PTESHM          0x00000020  /* Page of a shared memory segment (shm.c) */
+#ifndef NUMFRAMES
+#define NUMFRAMES       16          /* Frames the pager manages, a power of two */
+#endif
+#define SWAPFLASHDEV    6           /* Flash device holding swapped-out pages */
+#ifndef MAXSWAPBLOCKS
+#define MAXSWAPBLOCKS   1024        /* Swap flash blocks the pager uses at most */
+#endif
+#ifndef ZPOOLPAGES
+#define ZPOOLPAGES      8           /* RAM for compressed swapped-out pages (zpool.c) */
+#endif
+#define ZCHUNKSIZE      64          /* Allocation unit of the compressed pool */
+
+/* Shared memory segments (shm.c) */
+#ifndef MAXSEGMENTS
+#define MAXSEGMENTS     16          /* Segments that may exist at once */
+#endif
 
 /* Macro to load the Interval Timer */
 #define LDIT(T)	((* ((cpu_t *) INTERVALTMR)) = (T) * (* ((cpu_t *) TIMESCALEADDR))) 
@@ -110,6 +201,13 @@
 /* Macro to read the TOD clock */
 #define STCK(T) ((T) = ((* ((cpu_t *) TODLOADDR)) / (* ((cpu_t *) TIMESCALEADDR))))
 
+/* Process exit reasons (accounting records) */
+#define EXITNORMAL      0   /* SYS2 */
+#define EXITKILLED      1   /* An ancestor terminated */
+#define EXITBADSYSCALL  2   /* Unknown SYSCALL number */
+#define EXITNOSUPPORT   3   /* Exception to pass up without a support structure */
+#define EXITFAULT       4   /* Undefined exception */
+
 /* SYSCALL Constants*/
 #define CREATEPROCESS      1
 #define TERMINATEPROCESS   2
@@ -120,4 +218,22 @@
 #define WAITCLOCK          7
 #define GETSUPPORTPTR      8
 
+/* Nucleus statistics services: SYS9 and up belong to the support level */
+#define GETSEMSTATS       -1  /* Copy the a2 most contended semaphore records to a1 */
+#define GETWAITGRAPH      -2  /* Drain up to a2 wakeup records into a1 */
+#define GETLOADAVG        -3  /* Copy the load statistics to a1 */
+#define GETACCOUNTING     -4  /* Copy the caller's accounting record to a1 */
+#define GETPOOLSTATS      -5  /* Copy the NUMPOOLS kernel pool records to a1 */
+#define GETKPAGE          -6  /* Return the address of the shared kernel data page */
+#define GETPROFILE        -7  /* Copy up to a2 function profile records to a1 */
+#define DUMPPROFILE       -8  /* Print the hottest functions on the kernel log */
+#define GETPAGERSTATS     -9  /* Copy the pager statistics to a1 */
+#define GETPAGESTATS      -10 /* Copy the page allocator statistics to a1 */
+
+/* Nucleus memory services */
+#define FORKPROCESS       -11 /* SYS1 in a copy-on-write copy of the caller's address space */
+#define SHMCREATE         -12 /* Create an a1 byte shared segment, mapped at a2; returns its id */
+#define SHMMAP            -13 /* Map shared segment a1 at a2 */
+#define SHMUNMAP          -14 /* Unmap the shared segment mapped at a1 */
+
 #endif
@@ -7,14 +7,18 @@
  *  module.
  *
  *  Implements an exception handler, SYSCALL handler, SYSCALLs 1-8,
+ *  the nucleus statistics services (negative SYSCALL numbers),
  *  program trap exception handler, and TLB exception handler
  *
  */
 
+#include "../h/types.h"
+
 extern void exceptionHandler();
 
 extern void syscallHandler();
 extern int sysCreateProcess();
+extern int sysForkProcess();
 extern void sysTerminate();
 extern void sysPasseren();
 extern void sysVerhogen();
@@ -26,6 +30,8 @@ extern void *sysGetSupportPTR();
 extern void programTrapHandler();
 extern void TLBExceptionHandler();
 extern void updateCPUTime();
+extern void chargeBlockedTime(pcb_PTR p, int *semAdd);
+extern void sysGetAccounting();
 extern void passUpOrDie(int exceptType);
 extern void memcopy();
 
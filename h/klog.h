@@ -0,0 +1,65 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+/************************* KLOG.H *****************************
+ *
+ *  The externals declaration file for the kernel log.
+ *
+ *  KERROR, KWARN, KINFO and KDEBUG take a parenthesised printf-style
+ *  argument list, e.g. KWARN(("pid %u killed", p->p_pid)). Levels
+ *  above KLOGLEVEL (-DKLOGLEVEL=n, make KLOGLEVEL=n) compile to
+ *  nothing.
+ *
+ */
+
+#include "../h/types.h"
+
+#define KLOGERROR 0
+#define KLOGWARN  1
+#define KLOGINFO  2
+#define KLOGDEBUG 3
+
+#ifndef KLOGLEVEL
+#define KLOGLEVEL KLOGWARN
+#endif
+
+extern void klogBegin(int level);
+extern void klogPrintf(const char *fmt, ...);
+extern int klogInterrupt(unsigned int status);
+extern void klogSync();
+extern unsigned int klogDropped;
+
+#define KLOG(level, args) \
+    do                    \
+    {                     \
+        klogBegin(level); \
+        klogPrintf args;  \
+    } while (0)
+
+#if KLOGLEVEL >= KLOGERROR
+#define KERROR(args) KLOG(KLOGERROR, args)
+#else
+#define KERROR(args)
+#endif
+
+#if KLOGLEVEL >= KLOGWARN
+#define KWARN(args) KLOG(KLOGWARN, args)
+#else
+#define KWARN(args)
+#endif
+
+#if KLOGLEVEL >= KLOGINFO
+#define KINFO(args) KLOG(KLOGINFO, args)
+#else
+#define KINFO(args)
+#endif
+
+#if KLOGLEVEL >= KLOGDEBUG
+#define KDEBUG(args) KLOG(KLOGDEBUG, args)
+#else
+#define KDEBUG(args)
+#endif
+
+/******************************************************************/
+
+#endif
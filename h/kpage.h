@@ -0,0 +1,23 @@
+#ifndef KPAGE
+#define KPAGE
+
+/************************* KPAGE.H *****************************
+ *
+ *  The externals declaration file for the shared kernel data
+ *  page module.
+ *
+ *  A page of nucleus data that processes read directly instead of
+ *  trapping into the nucleus (see kpage_t and GETKPAGE).
+ *
+ */
+
+#include "../h/types.h"
+
+extern kpage_t kernelPage;
+
+extern void kpageDispatch(pcb_PTR p);
+extern void kpageTick();
+
+/******************************************************************/
+
+#endif
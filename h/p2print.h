@@ -0,0 +1,19 @@
+#ifndef P2PRINT
+#define P2PRINT
+
+/************************* P2PRINT.H *****************************
+ *
+ *  The externals declaration file for the terminal output helpers
+ *  shared by the phase 2 benchmark, workload and stress programs.
+ *
+ */
+
+extern int term_mut;
+
+extern void print(char *msg);
+extern void putnum(char *buf, int *pos, int n);
+extern void putstr(char *buf, int *pos, char *s);
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PAGER_H
+#define PAGER_H
+
+/************************* PAGER.H *****************************
+ *
+ *  The externals declaration file for the nucleus pager.
+ *
+ *  Pages whose page table entry has PTEPAGED set are brought in on
+ *  demand from the swap flash (SWAPFLASHDEV) into a pool of NUMFRAMES
+ *  frames, evicting with a clock (second chance) policy, and shared
+ *  copy-on-write between forked address spaces.
+ *
+ */
+
+#include "../h/types.h"
+
+extern int pagerSem;
+extern pagerstat_t pagerStats;
+
+extern void initPager();
+extern int pagerInUse(support_t *sup);
+extern int pagerAttach(support_t *sup);
+extern int pagerFork(support_t *parent, support_t *child);
+extern void pageFault(state_PTR savedState);
+extern int pagerInterrupt(int devNum, unsigned int status);
+extern void pagerCancel(pcb_PTR p);
+extern void pagerRelease(support_t *sup);
+extern void getPagerStats(pagerstat_t *buf);
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PALLOC
+#define PALLOC
+
+/************************* PALLOC.H *****************************
+ *
+ *  The externals declaration file for the physical page allocator.
+ *
+ *  A buddy system over the RAM between the end of the kernel image
+ *  and the first process' stacks below RAMTOP. Blocks are 2^order
+ *  contiguous pages (see pagestat_t and GETPAGESTATS).
+ *
+ */
+
+#include "../h/types.h"
+
+extern void initPages();
+extern void *allocPages(int order);
+extern void freePages(void *addr);
+extern int pagesOrder(unsigned int bytes);
+extern void getPageStats(pagestat_t *buf);
+
+/******************************************************************/
+
+#endif
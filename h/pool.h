@@ -0,0 +1,23 @@
+#ifndef POOL
+#define POOL
+
+/************************* POOL.H *****************************
+ *
+ *  The externals declaration file for the kernel pool accounting
+ *  module.
+ *
+ *  Size, entries in use, high-water mark and refused allocations of
+ *  each fixed-size kernel pool, indexed by POOLPCB ... POOLZPOOL.
+ *
+ */
+
+#include "../h/types.h"
+
+extern poolstat_t poolStats[NUMPOOLS];
+extern void poolGet(int pool);
+extern void poolPut(int pool);
+extern void poolFailed(int pool);
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PROF_H
+#define PROF_H
+
+/************************* PROF.H *****************************
+ *
+ *  The externals declaration file for the function profiler.
+ *
+ *  Built in with -DPROFILE (make PROFILE=1), which also compiles the
+ *  nucleus with -finstrument-functions so that every function entry
+ *  and exit reaches the hooks in prof.c. Without PROFILE the table
+ *  stays empty and GETPROFILE returns 0.
+ *
+ */
+
+#include "../h/types.h"
+
+/* Functions the entry/exit hooks must not be generated for */
+#define NOINSTR __attribute__((no_instrument_function))
+
+extern int getProfile(profrec_t *buf, int n) NOINSTR;
+extern void dumpProfile() NOINSTR;
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SHM
+#define SHM
+
+/************************* SHM.H *****************************
+ *
+ *  The externals declaration file for shared memory segments.
+ *
+ *  Page blocks the nucleus maps into several address spaces at once
+ *  (SHMCREATE, SHMMAP, SHMUNMAP), freed when the last mapping goes.
+ *
+ */
+
+#include "../h/types.h"
+
+extern int shmCreate(support_t *sup, unsigned int size, memaddr va);
+extern int shmMap(support_t *sup, int id, memaddr va);
+extern int shmUnmap(support_t *sup, memaddr va);
+extern int shmHold(support_t *sup);
+extern void shmRelease(support_t *sup);
+
+/******************************************************************/
+
+#endif
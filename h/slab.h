@@ -0,0 +1,24 @@
+#ifndef SLAB
+#define SLAB
+
+/************************* SLAB.H *****************************
+ *
+ *  The externals declaration file for the slab cache allocator.
+ *
+ *  Per-type caches of fixed-size kernel objects carved out of pages
+ *  from the page allocator (see kcache_t).
+ *
+ */
+
+#include "../h/types.h"
+
+extern kcache_t *kcacheList;
+
+extern void kcacheInit(kcache_t *c, char *name, unsigned int size, void (*ctor)(void *), int limit, int pool);
+extern void *kcacheAlloc(kcache_t *c);
+extern void kcacheFree(kcache_t *c, void *obj);
+extern int kcacheReap();
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef STATS
+#define STATS
+
+/************************* STATS.H *****************************
+ *
+ *  The externals declaration file for the system load statistics
+ *  module.
+ *
+ *  Samples the nucleus counters once per Interval Timer tick and
+ *  keeps 1/5/15-tick load averages and a ready queue depth histogram.
+ *
+ */
+
+#include "../h/types.h"
+
+extern void sampleLoad();
+extern void getLoadStats(loadstat_t *buf);
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef TLB_H
+#define TLB_H
+
+/************************* TLB.H *****************************
+ *
+ *  The externals declaration file for the nucleus TLB-refill
+ *  handler and ASID management.
+ *
+ */
+
+#include "../h/types.h"
+
+extern void tlbRefillHandler();
+extern void tlbLoadAsid(pcb_PTR p);
+extern void tlbUpdate(unsigned int entryHi, unsigned int entryLo);
+extern void tlbSyncPte(support_t *sup, int idx);
+extern unsigned int tlbRefills;
+extern unsigned int asidRecycles;
+
+/******************************************************************/
+
+#endif
@@ -106,12 +106,20 @@ typedef struct context_t
 	unsigned int c_pc;		 /* Program Counter */
 } context_t;
 
+/* Page table entry, as loaded into the TLB */
+typedef struct pteEntry_t
+{
+	unsigned int pte_entryHI; /* VPN and ASID */
+	unsigned int pte_entryLO; /* PFN and D/V/G bits */
+} pteEntry_t;
+
 /* Support Structure */
 typedef struct support_t
 {
-	int sup_asid;					/* Process ID (ASID) */
-	state_t sup_exceptState[2];		/* Stored exception states */
-	context_t sup_exceptContext[2]; /* Pass up contexts */
+	int sup_asid;									 /* Process ID (ASID) */
+	state_t sup_exceptState[2];						 /* Stored exception states */
+	context_t sup_exceptContext[2];					 /* Pass up contexts */
+	pteEntry_t sup_privatePgTbl[USERPGTBLSIZE];		 /* Page table, read by the TLB-refill handler */
 } support_t;
 
 /* Process Control Block Type */
@@ -132,9 +140,23 @@ typedef struct pcb_t
 	cpu_t p_time;			 /* CPU time used by process */
 	unsigned int p_startTOD; /* Time slice start (needed for SYS6) */
 	int *p_semAdd;			 /* Pointer to semaphore on which process is blocked */
+	cpu_t p_blockTOD;		 /* TOD when the process last blocked on p_semAdd */
+
+	/* Process accounting */
+	unsigned int p_pid;		  /* Unique id, never reused */
+	cpu_t p_createTOD;		  /* TOD at allocation */
+	unsigned int p_switches;  /* Times dispatched */
+	unsigned int p_syscalls;  /* SYSCALLs handled by the nucleus */
+
+	/* Blocking accounting */
+	unsigned int p_ioCount[DEVINTNUM]; /* SYS5 calls per device class (line 3..7) */
+	cpu_t p_ioTime;					   /* Time soft-blocked on device semaphores */
+	cpu_t p_clockTime;				   /* Time blocked in SYS7 */
+	cpu_t p_semTime;				   /* Time blocked on ordinary semaphores */
 
 	/* Support layer information */
 	support_t *p_supportStruct; /* Pointer to support struct */
+	void *p_stack;				/* Stack block allocated by SYS1, or NULL */
 
 } pcb_t, *pcb_PTR;
 
@@ -146,6 +168,151 @@ typedef struct semd_t
 	pcb_t *s_procQ;		   /* Tail pointer to a process queue */
 } semd_t;
 
+/* Per-process accounting record (see GETACCOUNTING) */
+typedef struct procacct_t
+{
+	cpu_t pa_cpuTime;					/* CPU time, as SYS6 */
+	unsigned int pa_ioCount[DEVINTNUM]; /* SYS5 calls per device class (line 3..7) */
+	cpu_t pa_ioTime;					/* Time soft-blocked on device semaphores */
+	cpu_t pa_clockTime;					/* Time blocked in SYS7 */
+	cpu_t pa_semTime;					/* Time blocked on ordinary semaphores */
+} procacct_t;
+
+/* Accounting record of a terminated process, written to flash */
+typedef struct acctrec_t
+{
+	unsigned int ar_pid;		/* Process id (0: empty slot) */
+	unsigned int ar_parent;		/* Parent's id, 0 if none */
+	cpu_t ar_lifetime;			/* Time from creation to termination */
+	cpu_t ar_cpuTime;			/* CPU time */
+	cpu_t ar_ioTime;			/* Time soft-blocked on devices */
+	cpu_t ar_clockTime;			/* Time blocked in SYS7 */
+	cpu_t ar_semTime;			/* Time blocked on ordinary semaphores */
+	unsigned int ar_switches;	/* Times dispatched */
+	unsigned int ar_syscalls;	/* SYSCALLs */
+	unsigned int ar_ioCount;	/* SYS5 calls */
+	int ar_exitReason;			/* EXITNORMAL ... EXITFAULT */
+	unsigned int ar_pad;		/* Keeps the record at 12 words */
+} acctrec_t;
+
+/* Per-function record of the PROFILE build */
+typedef struct profrec_t
+{
+	memaddr pr_fn;		  /* Function address */
+	unsigned int pr_calls; /* Number of calls */
+	cpu_t pr_inclusive;	  /* TOD ticks from entry to return, callees included */
+	cpu_t pr_exclusive;	  /* TOD ticks in the function itself */
+} profrec_t;
+
+/* Slab cache of fixed-size kernel objects (see slab.c) */
+typedef struct kcache_t
+{
+	char *kc_name;				/* Object type */
+	unsigned int kc_size;		/* Object size, aligned */
+	int kc_perSlab;				/* Objects in a slab */
+	void (*kc_ctor)(void *);	/* Constructor, or NULL */
+	int kc_limit;				/* Most objects handed out, 0 for no limit */
+	int kc_pool;				/* poolStats[] entry counting its objects */
+	struct slab_t *kc_partial;	/* Slabs with free and allocated objects */
+	struct slab_t *kc_full;		/* Slabs with no free object */
+	struct slab_t *kc_empty;	/* Slabs with no allocated object */
+	unsigned int kc_slabs;		/* Slabs (pages) held */
+	unsigned int kc_emptySlabs; /* Of which empty */
+	struct kcache_t *kc_next;	/* Next cache */
+} kcache_t;
+
+/* Page allocator statistics (see GETPAGESTATS) */
+typedef struct pagestat_t
+{
+	unsigned int pa_pages;				 /* Pages managed */
+	unsigned int pa_free;				 /* Pages free */
+	unsigned int pa_largest;			 /* Pages in the largest free block */
+	unsigned int pa_blocks[PAGEORDERS]; /* Free blocks of each order */
+	unsigned int pa_allocs;				 /* Blocks allocated */
+	unsigned int pa_frees;				 /* Blocks freed */
+	unsigned int pa_splits;				 /* Blocks split in two */
+	unsigned int pa_merges;				 /* Buddies merged */
+} pagestat_t;
+
+/* Pager statistics */
+typedef struct pagerstat_t
+{
+	unsigned int pg_faults;		/* Faults that waited for a frame */
+	unsigned int pg_softFaults;	/* Reference samples taken */
+	unsigned int pg_zeroFills;	/* Pages created zero-filled */
+	unsigned int pg_pageIns;	/* Pages read from the swap flash */
+	unsigned int pg_pageOuts;	/* Modified pages written back to the flash */
+	unsigned int pg_zpoolIns;	/* Pages decompressed from the RAM pool instead */
+	unsigned int pg_zpoolOuts;	/* Modified pages compressed into the RAM pool instead */
+	unsigned int pg_evictions;	/* Pages evicted by the clock */
+	unsigned int pg_shared;		/* Pages shared by FORKPROCESS */
+	unsigned int pg_copies;		/* Shared pages copied on a write */
+	unsigned int pg_blockHits;	/* Faults mapped to a frame already holding their block */
+	unsigned int pg_frames;		/* Frames holding a page (gauge) */
+	unsigned int pg_maps;		/* Entries mapping them (gauge) */
+	unsigned int pg_blocks;		/* Swap blocks referenced (gauge) */
+	unsigned int pg_blockRefs;	/* References to them, by entries and frames (gauge) */
+} pagerstat_t;
+
+/* Shared kernel data page, read by processes (see GETKPAGE) */
+typedef struct kpage_t
+{
+	unsigned int kp_seq;			   /* Odd while the nucleus is updating the page */
+	unsigned int kp_todBase;		   /* TOD of the last update */
+	unsigned int kp_timeScale;		   /* TOD ticks per microsecond */
+	unsigned int kp_pid;			   /* Running process */
+	cpu_t kp_cpuTime;				   /* Its CPU time up to kp_startTOD */
+	unsigned int kp_startTOD;		   /* TOD it was dispatched at */
+	unsigned int kp_switches;		   /* Dispatches since boot */
+	unsigned int kp_ticks;			   /* Interval Timer ticks since boot */
+	int kp_processCount;			   /* processCount at the last tick */
+	int kp_softBlockCount;			   /* softBlockCount at the last tick */
+	unsigned int kp_load[LOADPERIODS]; /* Load averages, LOADFSHIFT fraction bits */
+	unsigned int kp_tlbRefills;		   /* TLB misses served at the last tick */
+	unsigned int kp_asidRecycles;	   /* ASIDs given to a new address space */
+} kpage_t;
+
+/* Usage of one fixed-size kernel pool (see GETPOOLSTATS) */
+typedef struct poolstat_t
+{
+	unsigned int ps_size;	   /* Entries in the pool */
+	unsigned int ps_inUse;	   /* Entries allocated now */
+	unsigned int ps_highWater; /* Most entries ever allocated at once */
+	unsigned int ps_failures;  /* Allocations refused (or entries dropped) */
+} poolstat_t;
+
+/* Semaphore contention record kept by the ASL (see GETSEMSTATS) */
+typedef struct semstat_t
+{
+	int *ss_semAdd;				 /* Semaphore the record belongs to */
+	unsigned int ss_pCount;		 /* P operations */
+	unsigned int ss_blockCount;	 /* P operations that blocked */
+	unsigned int ss_queueLen;	 /* Processes blocked right now */
+	unsigned int ss_maxQueueLen; /* Longest queue seen */
+	cpu_t ss_waitTotal;			 /* Time spent blocked, summed over wakeups */
+	cpu_t ss_waitMax;			 /* Longest single wait */
+} semstat_t;
+
+/* System load statistics (see GETLOADAVG) */
+typedef struct loadstat_t
+{
+	unsigned int ls_ticks;					/* Interval Timer ticks sampled */
+	unsigned int ls_load[LOADPERIODS];		/* 1/5/15-tick load, LOADFSHIFT fraction bits */
+	unsigned int ls_running;				/* Last sample: ready or running processes */
+	unsigned int ls_softBlocked;			/* Last sample: softBlockCount */
+	unsigned int ls_processes;				/* Last sample: processCount */
+	unsigned int ls_rqHist[RQHISTBUCKETS]; /* Ticks by ready queue depth: 0, 1, 2-3, 4-7, ... */
+} loadstat_t;
+
+/* Wakeup record of the wait-for graph recorder (see GETWAITGRAPH) */
+typedef struct waitrec_t
+{
+	pcb_t *w_waker;	 /* Process that did the V, NULL for a device interrupt */
+	pcb_t *w_wakee;	 /* Process that was unblocked */
+	int *w_semAdd;	 /* Semaphore it was blocked on */
+	cpu_t w_wait;	 /* Time it spent blocked */
+} waitrec_t;
+
 /* Exception Type Constants */
 #define PGFAULTEXCEPT 0 /* Page Fault Exception */
 #define GENERALEXCEPT 1 /* General Exception */
@@ -0,0 +1,28 @@
+#ifndef WAITGRAPH_H
+#define WAITGRAPH_H
+
+/************************* WAITGRAPH.H *****************************
+ *
+ *  The externals declaration file for the wait-for graph recorder.
+ *
+ *  Built in with -DWAITGRAPH (make WAITGRAPH=1). Every wakeup done
+ *  by a V or a device interrupt is logged as (waker, wakee, semaphore,
+ *  wait) in a ring that GETWAITGRAPH drains. Without WAITGRAPH the
+ *  RECORDWAKE hook compiles to nothing and the ring is always empty.
+ *
+ */
+
+#include "../h/types.h"
+
+#ifdef WAITGRAPH
+extern void recordWake(pcb_PTR waker, pcb_PTR wakee, int *semAdd);
+#define RECORDWAKE(waker, wakee, semAdd) recordWake(waker, wakee, semAdd)
+#else
+#define RECORDWAKE(waker, wakee, semAdd)
+#endif
+
+extern int getWaitRecords(waitrec_t *buf, int n);
+
+/******************************************************************/
+
+#endif
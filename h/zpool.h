@@ -0,0 +1,23 @@
+#ifndef ZPOOL
+#define ZPOOL
+
+/************************* ZPOOL.H *****************************
+ *
+ *  The externals declaration file for the compressed swap pool.
+ *
+ *  A RAM tier in front of the swap flash: the pager keeps evicted
+ *  pages there, compressed and named by their swap block, until it
+ *  fills (see POOLZPOOL and pagerstat_t).
+ *
+ */
+
+#include "../h/types.h"
+
+extern void initZpool();
+extern int zpoolStore(int blk, memaddr page);
+extern int zpoolLoad(int blk, memaddr page);
+extern void zpoolFree(int blk);
+
+/******************************************************************/
+
+#endif
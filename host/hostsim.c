@@ -0,0 +1,1159 @@
+/************************** hostsim.c ******************************
+ *
+ * Host-side discrete-event simulator for evaluating the nucleus'
+ * scheduling behaviour at scale.
+ *
+ * The real nucleus (initial.c, scheduler.c, exceptions.c, interrupts.c,
+ * pcb.c, asl.c) is linked against the host libumps mock. The simulator
+ * plays the part of the CPU and of the devices:
+ * - A simulated TOD clock, Process Local Timer and Interval Timer. The
+ *   timers are exchanged with the nucleus through the same registers it
+ *   uses on uMPS3 (setTIMER / INTERVALTMR), so QUANTUM and CLOCKINTERVAL
+ *   take effect exactly as in the emulator.
+ * - A device model for disks, printers and terminal transmitters: a
+ *   command completes after a fixed latency (with jitter), raises the
+ *   device's bit in the interrupting-devices bitmap and waits for ACK.
+ *   Flash ACCTFLASHDEV takes the nucleus' own accounting writes; the
+ *   records in each written block are tallied by exit reason. It is
+ *   watched on the bus (hostWatchBus), so a write is seen as it is
+ *   issued and stays BUSY until it completes, also for the nucleus'
+ *   polling shutdown flush. Terminal KLOGTERM carries the kernel log
+ *   (saved with -K).
+ * - Synthetic processes. Instead of executing code, each process follows
+ *   a small program of compute bursts and SYSCALLs; SYSCALLs and
+ *   interrupts enter the nucleus through exceptionHandler() with the
+ *   BIOS Data Page filled in as the hardware would.
+ *
+ * A process is identified by register s0 of its state: the root process
+ * created by the nucleus has s0 == 0, workers created through SYS1 get
+ * 1..n. Kernel time is modelled as a fixed cost per nucleus entry.
+ *
+ * Workload classes:
+ * - cpu:  endless compute bursts; a work unit is one burst.
+ * - io:   a short burst, then a disk/printer/terminal command and SYS5.
+ * - lock: think time, P(lock), critical section, V(lock).
+ *
+ * Reported: throughput (work units per simulated second), per-class CPU
+ * share with Jain's fairness index, percentiles of ready-to-run
+ * latency (time spent in the Ready Queue) and of blocked time (device
+ * service or lock wait), the nucleus' load averages, and the ASL's most
+ * contended semaphores.
+ *
+ * Usage: hostsim [-c cpu] [-i io] [-l lock] [-L locks] [-u units]
+ *                [-k kcost] [-S bytes] [-t ms] [-s seed] [-w file] [-K file]
+ *                [-P file]
+ *   -c/-i/-l   number of processes per class        (default 8/8/8)
+ *   -L         number of distinct locks (max 256)    (default 4)
+ *   -u         work units per process, 0 = unlimited (default 0)
+ *   -k         nucleus entry cost in microseconds    (default 10)
+ *   -S         have SYS1 allocate worker stacks of this size (default 0)
+ *   -t         simulated run time in milliseconds    (default 10000)
+ *   -s         random seed                           (default 1)
+ *   -w         write the wakeups recorded by the nucleus to file as
+ *              "WAIT <waker> <wakee> <semaphore> <wait us>" lines, for
+ *              wfgraph (needs a nucleus built with WAITGRAPH=1)
+ *   -K         write the kernel log to file
+ *   -P         write the per-class results to file as p2load's
+ *              "LOAD <class> <procs> <units> <cpu_permille> <p50> <p90>
+ *              <p99>" lines (ready latency percentiles, in us) and a
+ *              final "LOAD_DONE", for perfrun.sh -H
+ * QUANTUM and MAXPROC are compile-time nucleus settings (see Makefile).
+ ***************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#undef NULL
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/asl.h"
+#define main nucleusMain /* initial.c is built with -Dmain=nucleusMain */
+#include "../h/initial.h"
+#undef main
+#include "../h/exceptions.h"
+#include "../h/interrupts.h"
+#include "../h/scheduler.h"
+#include "../h/waitgraph.h"
+#include "../h/stats.h"
+#include "../h/acct.h"
+#include "../h/kpage.h"
+#include "../h/palloc.h"
+#include "../h/slab.h"
+#include "../h/prof.h"
+#include "../h/klog.h"
+#include "hostumps.h"
+
+#define CPUCLASS   0
+#define IOCLASS    1
+#define LOCKCLASS  2
+#define NUMCLASSES 3
+#define ROOTCLASS  (-1)
+
+#define IDLEPID (-1) /* s0 of the state saved while the CPU waits */
+#define ROOTPID 0
+
+#define NEVER 0x7FFFFFFFFFFFFFFFLL
+
+/* Workload shape (microseconds) */
+#define CPUBURST   20000
+#define IOBURST    500
+#define THINKTIME  1000
+#define CRITTIME   300
+#define DISKTIME   8000
+#define PRINTTIME  3000
+#define TERMTIME   1500
+#define FLASHTIME  2000
+#define FLASHPOLLS 3    /* Status reads a polled flash write stays BUSY for */
+#define FLASHBLOCKS 64
+
+#define MAXLOCKS 256
+#define SYSEXCCODE 8 /* Cause.ExcCode of a SYSCALL */
+
+/* Terminal command issued by the io processes */
+#define TRANSMITCHAR    2
+
+/* Kinds of step in a process program */
+#define COMPUTE 0
+#define SYSCALLSTEP 1
+
+typedef long long simtime_t;
+
+typedef struct step_t
+{
+    int kind;       /* COMPUTE or SYSCALLSTEP */
+    int burst;      /* COMPUTE: microseconds */
+    int a0, a1, a2; /* SYSCALLSTEP: arguments */
+} step_t;
+
+typedef struct simproc_t
+{
+    int cls;              /* workload class, ROOTCLASS for pid 0 */
+    int step;             /* index of the next step in the program */
+    int burstLeft;        /* microseconds left in the current COMPUTE step */
+    int unitPending;      /* a work unit ended with the last SYSCALL */
+    int unitsLeft;        /* units still to run, -1 = unlimited */
+    int unitsDone;
+    int lock;             /* LOCKCLASS: lock index */
+    int intLine, devNum;  /* IOCLASS: device used */
+    int finishing;        /* done with work: V(done) then SYS2 */
+    int exited;
+    pcb_PTR pcb;          /* nucleus pcb, learnt at dispatch */
+    simtime_t cpu;        /* simulated CPU time consumed */
+    simtime_t blockedAt;  /* valid while blocked in the nucleus */
+    simtime_t readyAt;    /* valid while sitting in the Ready Queue */
+    int blocked, ready;
+} simproc_t;
+
+typedef struct simdev_t
+{
+    int busy;           /* a command is in progress */
+    simtime_t doneAt;   /* completion time of the command in progress */
+    int queued;         /* commands waiting behind the one in progress */
+} simdev_t;
+
+typedef struct samples_t
+{
+    simtime_t *v;
+    int n, max;
+} samples_t;
+
+/* Configuration */
+HIDDEN int nCpu = 8, nIo = 8, nLock = 8, nLocks = 4, units = 0;
+HIDDEN int kernelCost = 10;
+HIDDEN int stackSize = 0; /* SYS1 kernel-provided stack, bytes */
+HIDDEN simtime_t horizon = 10000000;
+HIDDEN unsigned int seed = 1;
+HIDDEN FILE *waitFile = NULL;
+HIDDEN FILE *klogFile = NULL;
+HIDDEN FILE *perfFile = NULL;
+HIDDEN long klogChars = 0;
+HIDDEN const char *progName = "hostsim";
+
+/* Simulated machine */
+HIDDEN simtime_t now = 0;
+HIDDEN simtime_t pltDeadline = NEVER;
+HIDDEN simtime_t itDeadline = NEVER;
+HIDDEN unsigned int pltWritten, itWritten; /* timer values handed to the nucleus */
+HIDDEN simdev_t devs[DEVINTNUM][DEVPERINT];
+HIDDEN state_t cpuState;  /* registers of the running process */
+HIDDEN state_t idleState; /* what the CPU "saves" when interrupted in WAIT */
+HIDDEN int running = IDLEPID;
+HIDDEN int halted = 0;
+HIDDEN jmp_buf kernelExit;
+
+/* Processes and the objects they hand to the nucleus (statics, so their
+   addresses fit in 32-bit registers) */
+HIDDEN simproc_t *procs;
+HIDDEN int nProcs;
+HIDDEN state_t workerStates[MAXPROC];
+HIDDEN int locks[MAXLOCKS];
+HIDDEN int doneSem = 0;
+
+/* Statistics */
+HIDDEN long kernelEntries = 0, contextSwitches = 0, preemptions = 0;
+HIDDEN long acctBlocks = 0, acctExits[EXITFAULT + 1];
+HIDDEN int flashPolls = 0; /* Status reads left until a polled write completes */
+HIDDEN samples_t readyLat[NUMCLASSES], blockTime[NUMCLASSES];
+
+/* Referenced by initial.c: the root process starts at test() */
+void test() {}
+
+HIDDEN unsigned int nextRand()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+HIDDEN void addSample(samples_t *s, simtime_t v)
+{
+    if (s->n == s->max)
+    {
+        s->max = s->max ? 2 * s->max : 1024;
+        s->v = realloc(s->v, s->max * sizeof(simtime_t));
+        if (s->v == 0)
+        {
+            fprintf(stderr, "hostsim: out of memory\n");
+            exit(1);
+        }
+    }
+    s->v[s->n++] = v;
+}
+
+/*********************** Nucleus entry/exit ***********************/
+
+/**
+ * Hands the current timer values to the nucleus through its registers.
+ */
+HIDDEN void writeTimers()
+{
+    simtime_t plt = pltDeadline == NEVER ? 0x7FFFFFFF : pltDeadline - now;
+    simtime_t it = itDeadline == NEVER ? 0x7FFFFFFF : itDeadline - now;
+
+    pltWritten = (unsigned int)plt;
+    itWritten = (unsigned int)it;
+    setTIMER(pltWritten);
+    *(unsigned int *)INTERVALTMR = itWritten;
+    hostSetTOD((unsigned int)now);
+}
+
+/**
+ * Picks up timer reloads: a register that no longer holds the value we
+ * wrote was loaded by the nucleus.
+ */
+HIDDEN void readTimers()
+{
+    unsigned int plt = getTIMER();
+    unsigned int it = *(unsigned int *)INTERVALTMR;
+
+    if (plt != pltWritten)
+        pltDeadline = now + (int)plt;
+    if (it != itWritten)
+        itDeadline = now + (int)it;
+}
+
+/**
+ * A device leaves the interrupting state once the nucleus writes ACK;
+ * the next queued command, if any, then starts.
+ */
+HIDDEN void readAcks()
+{
+    int line, dev;
+    for (line = DISKINT; line <= TERMINT; line++)
+    {
+        unsigned int *bitmap = INTDEVBITMAP_ADDR(line);
+        for (dev = 0; dev < DEVPERINT; dev++)
+        {
+            device_t *reg = DEV_REG_ADDR(line, dev);
+            unsigned int *cmd = line == TERMINT ? &reg->t_transm_command : &reg->d_command;
+            unsigned int *status = line == TERMINT ? &reg->t_transm_status : &reg->d_status;
+
+            if ((*bitmap & (1 << dev)) && *cmd == ACK)
+            {
+                simdev_t *d = &devs[line - DISKINT][dev];
+                int latency = line == DISKINT ? DISKTIME : line == PRNTINT ? PRINTTIME : TERMTIME;
+
+                *bitmap &= ~(1 << dev);
+                *status = READY;
+                *cmd = RESET;
+                if (d->queued > 0)
+                {
+                    d->queued--;
+                    d->busy = 1;
+                    d->doneAt = now + latency - latency / 4 + (int)(nextRand() % (latency / 2 + 1));
+                }
+            }
+        }
+    }
+}
+
+HIDDEN int pidOf(pcb_PTR p);
+HIDDEN char *semName(int *s);
+
+/**
+ * Moves the wakeups the nucleus recorded during the last entry to the
+ * -w file. Both processes are still alive here, so their pids are valid.
+ */
+HIDDEN void dumpWaits()
+{
+    waitrec_t recs[64];
+    int i, n;
+
+    while ((n = getWaitRecords(recs, 64)) > 0)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (recs[i].w_waker == NULL)
+                fprintf(waitFile, "WAIT dev %d", pidOf(recs[i].w_wakee));
+            else
+                fprintf(waitFile, "WAIT %d %d", pidOf(recs[i].w_waker), pidOf(recs[i].w_wakee));
+            fprintf(waitFile, " %s %d\n", semName(recs[i].w_semAdd), recs[i].w_wait);
+        }
+    }
+}
+
+/**
+ * Bus watcher: models the accounting flash as the nucleus sees it. A
+ * WRITEBLK tallies the records of its block and makes the device BUSY
+ * until it completes, FLASHTIME later with an interrupt, or once the
+ * nucleus has polled its status FLASHPOLLS times (the shutdown flush
+ * spins on it with interrupts off). An ACK makes it READY again.
+ */
+HIDDEN void flashBus(unsigned int addr)
+{
+    device_t *reg = DEV_REG_ADDR(FLASHINT, ACCTFLASHDEV);
+    simdev_t *d = &devs[FLASHINT - DISKINT][ACCTFLASHDEV];
+    unsigned int *bitmap = INTDEVBITMAP_ADDR(FLASHINT);
+    acctrec_t *rec;
+    unsigned int i;
+
+    if (addr == (unsigned int)(unsigned long)&reg->d_status)
+    {
+        if (d->busy && --flashPolls == 0)
+        {
+            reg->d_status = READY;
+            *bitmap |= 1 << ACCTFLASHDEV;
+            d->busy = 0;
+        }
+        return;
+    }
+    if (addr != (unsigned int)(unsigned long)&reg->d_command)
+        return;
+
+    switch (reg->d_command & 0xFF)
+    {
+    case FLASHWRITEBLK:
+        rec = (acctrec_t *)(unsigned long)reg->d_data0;
+        for (i = 0; i < PAGESIZE / sizeof(acctrec_t); i++)
+            if (rec[i].ar_pid != 0 && rec[i].ar_exitReason >= 0 && rec[i].ar_exitReason <= EXITFAULT)
+                acctExits[rec[i].ar_exitReason]++;
+        acctBlocks++;
+
+        reg->d_command = RESET;
+        reg->d_status = BUSY;
+        d->busy = 1;
+        d->doneAt = now + FLASHTIME;
+        flashPolls = FLASHPOLLS;
+        break;
+    case ACK:
+        reg->d_command = RESET;
+        reg->d_status = READY;
+        *bitmap &= ~(1 << ACCTFLASHDEV);
+        break;
+    }
+}
+
+/**
+ * Starts the transmission of a kernel log character and appends it to
+ * the -K file. The nucleus sends the next character right after its
+ * ACK, so a command also clears the pending interrupt; the status stays
+ * READY so that the nucleus' shutdown flush never spins.
+ */
+HIDDEN void klogCommands()
+{
+    device_t *reg = DEV_REG_ADDR(TERMINT, KLOGTERM);
+    simdev_t *d = &devs[TERMINT - DISKINT][KLOGTERM];
+
+    if ((reg->t_transm_command & 0xFF) != PRINTCHR)
+        return;
+
+    if (klogFile != NULL)
+        fputc((reg->t_transm_command >> BYTELEN) & 0xFF, klogFile);
+    klogChars++;
+
+    reg->t_transm_command = RESET;
+    *INTDEVBITMAP_ADDR(TERMINT) &= ~(1 << KLOGTERM);
+    d->busy = 1;
+    d->doneAt = now + TERMTIME;
+}
+
+/**
+ * Runs nucleus code until it gives the CPU back, then brings the
+ * simulated machine up to date. Returns the HOSTxxx exit reason.
+ */
+HIDDEN int enterKernel(void (*entry)())
+{
+    int why;
+
+    kernelEntries++;
+    writeTimers();
+
+    why = setjmp(kernelExit);
+    if (why == 0)
+    {
+        hostCatchExits(kernelExit);
+        hostWatchBus(flashBus);
+        entry();
+        fprintf(stderr, "hostsim: nucleus returned to its caller\n");
+        exit(1);
+    }
+
+    hostWatchBus(NULL);
+    readTimers();
+    readAcks();
+    klogCommands();
+    if (waitFile != NULL)
+        dumpWaits();
+    now += kernelCost;
+    return why;
+}
+
+/************************ Process programs ************************/
+
+HIDDEN int pidOf(pcb_PTR p)
+{
+    return p->p_s.s_s0;
+}
+
+/**
+ * Returns the step the process executes next.
+ */
+HIDDEN void currentStep(simproc_t *p, step_t *st)
+{
+    st->kind = SYSCALLSTEP;
+    st->a1 = st->a2 = 0;
+
+    if (p->cls == ROOTCLASS)
+    {
+        if (p->step < nProcs - 1)
+        {
+            st->a0 = CREATEPROCESS;
+            st->a1 = (int)&workerStates[p->step];
+            st->a2 = (int)NULL; /* No support structure */
+        }
+        else if (p->step < 2 * (nProcs - 1))
+        {
+            st->a0 = PASSEREN;
+            st->a1 = (int)&doneSem;
+        }
+        else
+            st->a0 = TERMINATEPROCESS;
+        return;
+    }
+
+    if (p->finishing)
+    {
+        st->a0 = p->step == 0 ? VERHOGEN : TERMINATEPROCESS;
+        st->a1 = (int)&doneSem;
+        return;
+    }
+
+    switch (p->cls)
+    {
+    case CPUCLASS:
+        st->kind = COMPUTE;
+        st->burst = CPUBURST;
+        break;
+
+    case IOCLASS:
+        if (p->step == 0)
+        {
+            st->kind = COMPUTE;
+            st->burst = IOBURST;
+        }
+        else
+        {
+            st->a0 = WAITIO;
+            st->a1 = p->intLine;
+            st->a2 = p->devNum;
+        }
+        break;
+
+    case LOCKCLASS:
+        if (p->step == 0 || p->step == 2)
+        {
+            st->kind = COMPUTE;
+            st->burst = p->step == 0 ? THINKTIME : CRITTIME;
+        }
+        else
+        {
+            st->a0 = p->step == 1 ? PASSEREN : VERHOGEN;
+            st->a1 = (int)&locks[p->lock];
+        }
+        break;
+    }
+}
+
+/**
+ * Moves past the step just executed (or just issued, for SYSCALLs).
+ */
+HIDDEN void advance(simproc_t *p)
+{
+    int last = p->cls == CPUCLASS ? 0 : p->cls == IOCLASS ? 1 : 3;
+
+    p->burstLeft = 0;
+    if (p->cls == ROOTCLASS || p->finishing || p->step < last)
+    {
+        p->step++;
+        return;
+    }
+
+    p->step = 0;
+    p->unitPending = 1;
+}
+
+/**
+ * Called whenever the process is about to run a step: credits a work
+ * unit finished by its previous SYSCALL and switches to the exit
+ * sequence once all units are done.
+ */
+HIDDEN void settleUnit(simproc_t *p)
+{
+    if (!p->unitPending)
+        return;
+
+    p->unitPending = 0;
+    p->unitsDone++;
+    if (p->unitsLeft > 0 && --p->unitsLeft == 0)
+    {
+        p->finishing = 1;
+        p->step = 0;
+    }
+}
+
+/**
+ * Starts a device command on behalf of an I/O process. Commands to a
+ * busy device are queued and start after the previous one is ACKed.
+ */
+HIDDEN void issueCommand(int line, int dev)
+{
+    simdev_t *d = &devs[line - DISKINT][dev];
+    int latency = line == DISKINT ? DISKTIME : line == PRNTINT ? PRINTTIME : TERMTIME;
+
+    if (d->busy || (*INTDEVBITMAP_ADDR(line) & (1 << dev)))
+    {
+        d->queued++;
+        return;
+    }
+
+    d->busy = 1;
+    d->doneAt = now + latency - latency / 4 + (int)(nextRand() % (latency / 2 + 1));
+}
+
+/*********************** Process bookkeeping **********************/
+
+/**
+ * Records the process given the CPU by the last nucleus exit and
+ * accounts for the one that lost it.
+ */
+HIDDEN void switchTo(int pid)
+{
+    int prev = running;
+
+    running = pid;
+    if (pid == prev)
+        return;
+
+    if (prev >= 0 && !procs[prev].exited && procs[prev].pcb != NULL)
+    {
+        simproc_t *p = &procs[prev];
+        if (p->pcb->p_semAdd != NULL)
+        {
+            p->blocked = 1;
+            p->blockedAt = now;
+        }
+        else
+        {
+            p->ready = 1;
+            p->readyAt = now;
+            preemptions++;
+        }
+    }
+
+    if (pid >= 0)
+    {
+        simproc_t *p = &procs[pid];
+        contextSwitches++;
+        if (p->ready)
+        {
+            if (p->cls != ROOTCLASS)
+                addSample(&readyLat[p->cls], now - p->readyAt);
+            p->ready = 0;
+        }
+    }
+}
+
+/**
+ * A process the nucleus just unblocked enters the Ready Queue.
+ */
+HIDDEN void noteWakeup(pcb_PTR w)
+{
+    simproc_t *p;
+
+    if (w == NULL || w->p_semAdd != NULL)
+        return; /* still blocked */
+
+    p = &procs[pidOf(w)];
+    if (p->blocked && p->cls != ROOTCLASS)
+        addSample(&blockTime[p->cls], now - p->blockedAt);
+    p->blocked = 0;
+    p->ready = 1;
+    p->readyAt = now;
+}
+
+/**
+ * Applies the outcome of a nucleus pass.
+ */
+HIDDEN void kernelDone(int why, pcb_PTR wakeCandidate)
+{
+    int pid = IDLEPID;
+
+    switch (why)
+    {
+    case HOSTLDST:
+        pid = hostResumed->s_s0;
+        if (pid != IDLEPID)
+        {
+            memcpy(&cpuState, hostResumed, sizeof(state_t));
+            procs[pid].pcb = currentProcess;
+        }
+        break;
+
+    case HOSTWAIT:
+        break;
+
+    case HOSTHALT:
+        halted = 1;
+        break;
+
+    case HOSTPANIC:
+        fprintf(stderr, "hostsim: nucleus PANIC at t=%lld us\n", now);
+        exit(2);
+
+    default:
+        fprintf(stderr, "hostsim: unexpected pass up (LDCXT) at t=%lld us\n", now);
+        exit(2);
+    }
+
+    noteWakeup(wakeCandidate);
+    switchTo(pid);
+}
+
+/************************** Event loop ****************************/
+
+/**
+ * Head waiter on a semaphore the coming nucleus pass may V.
+ */
+HIDDEN pcb_PTR waiterOn(int *semAdd)
+{
+    return *semAdd < 0 ? headBlocked(semAdd) : NULL;
+}
+
+/**
+ * Delivers all pending interrupts (the nucleus handles the highest
+ * priority one; the rest stay pending for the next pass).
+ */
+HIDDEN void raiseInterrupt(int pltDue, int itDue, unsigned int devLines)
+{
+    state_t *bios = (state_t *)BIOSDATAPAGE;
+    pcb_PTR cand = NULL;
+    unsigned int cause = devLines << IPSHIFT;
+
+    memcpy(bios, running >= 0 ? &cpuState : &idleState, sizeof(state_t));
+    if (pltDue)
+        cause |= 1 << (IPSHIFT + 1);
+    if (itDue)
+        cause |= 1 << (IPSHIFT + 2);
+    bios->s_cause = cause; /* ExcCode 0: interrupt */
+
+    if (!pltDue && !itDue)
+    {
+        int line = DISKINT, dev = 0, idx;
+        while (!(devLines & (1 << line)))
+            line++;
+        while (!(*INTDEVBITMAP_ADDR(line) & (1 << dev)))
+            dev++;
+        idx = line == TERMINT ? 4 * DEVPERINT + dev * 2 : (line - DISKINT) * DEVPERINT + dev;
+        cand = waiterOn(&deviceSemaphores[idx]);
+    }
+
+    kernelDone(enterKernel(exceptionHandler), cand);
+}
+
+/**
+ * The running process executes a SYSCALL.
+ */
+HIDDEN void raiseSyscall(simproc_t *p, step_t *st)
+{
+    state_t *bios = (state_t *)BIOSDATAPAGE;
+    pcb_PTR cand = NULL;
+
+    memcpy(bios, &cpuState, sizeof(state_t));
+    bios->s_cause = SYSEXCCODE << 2;
+    bios->s_status &= KUPBITOFF; /* nucleus services need kernel mode */
+    bios->s_a0 = st->a0;
+    bios->s_a1 = st->a1;
+    bios->s_a2 = st->a2;
+    bios->s_a3 = st->a0 == CREATEPROCESS ? stackSize : 0;
+
+    if (st->a0 == VERHOGEN)
+        cand = waiterOn((int *)st->a1);
+    else if (st->a0 == WAITIO)
+    {
+        device_t *reg = DEV_REG_ADDR(st->a1, st->a2);
+        if (st->a1 == TERMINT)
+            reg->t_transm_command = TRANSMITCHAR;
+        else
+            reg->d_command = 3; /* READBLK / PRINTCHR: any command will do */
+        issueCommand(st->a1, st->a2);
+    }
+    else if (st->a0 == TERMINATEPROCESS)
+        p->exited = 1;
+
+    advance(p);
+    kernelDone(enterKernel(exceptionHandler), cand);
+}
+
+/**
+ * Moves finished device commands to the interrupting state and returns
+ * the Cause.IP bits of lines with pending device interrupts.
+ */
+HIDDEN unsigned int pollDevices()
+{
+    unsigned int lines = 0;
+    int line, dev;
+
+    for (line = DISKINT; line <= TERMINT; line++)
+    {
+        unsigned int *bitmap = INTDEVBITMAP_ADDR(line);
+        for (dev = 0; dev < DEVPERINT; dev++)
+        {
+            simdev_t *d = &devs[line - DISKINT][dev];
+            if (d->busy && d->doneAt <= now)
+            {
+                device_t *reg = DEV_REG_ADDR(line, dev);
+                if (line == TERMINT)
+                    reg->t_transm_status = CHARTRANSMITTED;
+                else
+                    reg->d_status = READY;
+                *bitmap |= 1 << dev;
+                d->busy = 0;
+            }
+        }
+        if (*bitmap)
+            lines |= 1 << line;
+    }
+    return lines;
+}
+
+HIDDEN simtime_t nextDeviceEvent()
+{
+    simtime_t t = NEVER;
+    int line, dev;
+
+    for (line = 0; line < DEVINTNUM; line++)
+        for (dev = 0; dev < DEVPERINT; dev++)
+            if (devs[line][dev].busy && devs[line][dev].doneAt < t)
+                t = devs[line][dev].doneAt;
+    return t;
+}
+
+HIDDEN void run()
+{
+    step_t st;
+
+    memset(&st, 0, sizeof(step_t));
+    kernelDone(enterKernel(nucleusMain), NULL);
+
+    while (!halted && now < horizon)
+    {
+        simproc_t *p = running >= 0 ? &procs[running] : NULL;
+        simtime_t next = MIN(itDeadline, nextDeviceEvent());
+        unsigned int devLines;
+        int pltDue, itDue;
+
+        if (p != NULL)
+        {
+            settleUnit(p);
+            currentStep(p, &st);
+            if (st.kind == COMPUTE && p->burstLeft == 0)
+                p->burstLeft = st.burst;
+
+            next = MIN(next, pltDeadline);
+            next = MIN(next, st.kind == COMPUTE ? now + p->burstLeft : now);
+        }
+
+        if (next == NEVER)
+        {
+            fprintf(stderr, "hostsim: no future events at t=%lld us\n", now);
+            exit(2);
+        }
+        next = MIN(next, horizon);
+
+        if (p != NULL && next > now)
+        {
+            p->cpu += next - now;
+            if (st.kind == COMPUTE)
+                p->burstLeft -= next - now;
+        }
+        if (next > now)
+            now = next;
+
+        devLines = pollDevices();
+        pltDue = p != NULL && pltDeadline <= now;
+        itDue = itDeadline <= now;
+
+        if (p != NULL && st.kind == COMPUTE && p->burstLeft == 0)
+            advance(p); /* burst over; a zero burstLeft now means "not started" */
+
+        if (pltDue || itDue || devLines)
+            raiseInterrupt(pltDue, itDue, devLines);
+        else if (p != NULL && st.kind == SYSCALLSTEP)
+            raiseSyscall(p, &st);
+    }
+}
+
+/**************************** Setup *******************************/
+
+HIDDEN void setupWorkload()
+{
+    int i, pid;
+
+    nProcs = 1 + nCpu + nIo + nLock;
+    if (nProcs > MAXPROC)
+    {
+        fprintf(stderr, "hostsim: %d processes exceed MAXPROC (%d)\n", nProcs, MAXPROC);
+        exit(1);
+    }
+
+    procs = calloc(nProcs, sizeof(simproc_t));
+    if (procs == 0)
+    {
+        fprintf(stderr, "hostsim: out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < nLocks; i++)
+        locks[i] = 1;
+
+    procs[ROOTPID].cls = ROOTCLASS;
+    for (pid = 1; pid < nProcs; pid++)
+    {
+        simproc_t *p = &procs[pid];
+        int k = pid - 1;
+
+        p->cls = k < nCpu ? CPUCLASS : k < nCpu + nIo ? IOCLASS : LOCKCLASS;
+        p->unitsLeft = units > 0 ? units : -1;
+        p->lock = pid % nLocks;
+        p->intLine = pid % 3 == 0 ? DISKINT : pid % 3 == 1 ? PRNTINT : TERMINT;
+        p->devNum = (pid / 3) % DEVPERINT;
+        if (p->intLine == TERMINT && p->devNum == KLOGTERM)
+            p->devNum = 0; /* The kernel log's terminal */
+
+        workerStates[k].s_s0 = pid;
+        workerStates[k].s_status = IEPBITON | IM | TEBITON;
+    }
+
+    idleState.s_s0 = IDLEPID;
+    idleState.s_status = IECON | IM;
+
+    DEV_REG_ADDR(FLASHINT, ACCTFLASHDEV)->d_status = READY;
+    DEV_REG_ADDR(FLASHINT, ACCTFLASHDEV)->d_data1 = FLASHBLOCKS;
+    DEV_REG_ADDR(TERMINT, KLOGTERM)->t_transm_status = READY;
+}
+
+HIDDEN int cmpTime(const void *a, const void *b)
+{
+    simtime_t x = *(const simtime_t *)a, y = *(const simtime_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+HIDDEN simtime_t percentile(samples_t *s, int pct)
+{
+    if (s->n == 0)
+        return 0;
+    return s->v[(long)(s->n - 1) * pct / 100];
+}
+
+/*
+ * Returns a printable name for a semaphore the simulation knows
+ * (in a static buffer, no blanks).
+ */
+HIDDEN char *semName(int *s)
+{
+    static char name[32];
+
+    if (s >= &locks[0] && s < &locks[MAXLOCKS])
+        sprintf(name, "lock%d", (int)(s - locks));
+    else if (s == &deviceSemaphores[NUM_DEVICES])
+        sprintf(name, "pseudo-clock");
+    else if (s >= &deviceSemaphores[0] && s < &deviceSemaphores[NUM_DEVICES])
+        sprintf(name, "device%d", (int)(s - deviceSemaphores));
+    else if (s == &doneSem)
+        sprintf(name, "done");
+    else
+        sprintf(name, "%p", (void *)s);
+    return name;
+}
+
+/*
+ * Prints the nucleus' own view of the most contended semaphores.
+ */
+#define TOPSEMS 5
+
+HIDDEN void reportSemStats()
+{
+    semstat_t top[TOPSEMS];
+    int i, n = getSemStats(top, TOPSEMS);
+
+    printf("\n%-14s %9s %9s %6s %6s %12s %10s\n", "semaphore", "P", "blocked", "queue", "max",
+           "wait us", "max wait");
+    for (i = 0; i < n; i++)
+    {
+        printf("%-14s %9u %9u %6u %6u %12d %10d\n", semName(top[i].ss_semAdd), top[i].ss_pCount, top[i].ss_blockCount,
+               top[i].ss_queueLen, top[i].ss_maxQueueLen, top[i].ss_waitTotal, top[i].ss_waitMax);
+    }
+}
+
+/*
+ * Prints the function profile of a PROFILE build, naming functions from
+ * the executable's symbol table. Simulated time stands still inside the
+ * nucleus, so only the call counts are meaningful here; the emulator
+ * gives real times. stdio reports failure with a real null pointer,
+ * hence the comparisons with 0 (NULL is the nucleus' own).
+ */
+#define TOPFUNCS 16
+
+HIDDEN void reportProfile()
+{
+    profrec_t top[TOPFUNCS];
+    char cmd[512], line[256], sym[64], names[TOPFUNCS][64];
+    unsigned long addr;
+    char type;
+    FILE *nm;
+    int i, n = getProfile(top, TOPFUNCS);
+
+    if (n == 0)
+        return;
+
+    for (i = 0; i < n; i++)
+        sprintf(names[i], "0x%x", top[i].pr_fn);
+    sprintf(cmd, "nm %.500s", progName);
+    nm = popen(cmd, "r");
+    while (nm != 0 && fgets(line, sizeof(line), nm) != 0)
+    {
+        if (sscanf(line, "%lx %c %63s", &addr, &type, sym) != 3)
+            continue;
+        for (i = 0; i < n; i++)
+        {
+            if (addr == top[i].pr_fn)
+                strcpy(names[i], sym);
+        }
+    }
+    if (nm != 0)
+        pclose(nm);
+
+    printf("\n%-28s %10s %12s %12s\n", "function", "calls", "incl TOD", "excl TOD");
+    for (i = 0; i < n; i++)
+        printf("%-28s %10u %12d %12d\n", names[i], top[i].pr_calls, top[i].pr_inclusive, top[i].pr_exclusive);
+}
+
+HIDDEN void report()
+{
+    static const char *names[NUMCLASSES] = {"cpu", "io", "lock"};
+    static const char *poolNames[NUMPOOLS] = {"pcb", "semd", "semstat", "acct", "waitgraph", "pages", "pmap", "shm", "zpool"};
+    double seconds = now / 1.0e6;
+    long totalUnits = 0;
+    simtime_t totalCpu = 0;
+    loadstat_t load;
+    kpage_t kp;
+    pagestat_t pages;
+    kcache_t *cache;
+    unsigned int seq;
+    int c, pid;
+
+    for (pid = 1; pid < nProcs; pid++)
+        totalCpu += procs[pid].cpu;
+
+    printf("simulated %.3f s  QUANTUM=%d us  MAXPROC=%d  processes=%d  kernel cost=%d us\n",
+           seconds, QUANTUM, MAXPROC, nProcs, kernelCost);
+    printf("nucleus entries %ld  context switches %ld  preemptions/yields %ld%s\n\n",
+           kernelEntries, contextSwitches, preemptions, halted ? "  (all processes finished)" : "");
+
+    printf("%-5s %5s %9s %10s %6s %6s   %-31s   %-31s\n", "class", "procs", "units", "units/s",
+           "cpu%", "jain", "ready latency us p50/p90/p99/max", "blocked us p50/p90/p99/max");
+
+    for (c = 0; c < NUMCLASSES; c++)
+    {
+        long u = 0;
+        int n = 0;
+        double sum = 0, sumSq = 0;
+        simtime_t cpu = 0;
+        char lat[64], blk[64];
+
+        for (pid = 1; pid < nProcs; pid++)
+        {
+            if (procs[pid].cls != c)
+                continue;
+            n++;
+            u += procs[pid].unitsDone;
+            cpu += procs[pid].cpu;
+            sum += procs[pid].cpu;
+            sumSq += (double)procs[pid].cpu * procs[pid].cpu;
+        }
+        if (n == 0)
+            continue;
+        totalUnits += u;
+
+        qsort(readyLat[c].v, readyLat[c].n, sizeof(simtime_t), cmpTime);
+        qsort(blockTime[c].v, blockTime[c].n, sizeof(simtime_t), cmpTime);
+        sprintf(lat, "%lld/%lld/%lld/%lld", percentile(&readyLat[c], 50), percentile(&readyLat[c], 90),
+                percentile(&readyLat[c], 99), percentile(&readyLat[c], 100));
+        sprintf(blk, "%lld/%lld/%lld/%lld", percentile(&blockTime[c], 50), percentile(&blockTime[c], 90),
+                percentile(&blockTime[c], 99), percentile(&blockTime[c], 100));
+
+        printf("%-5s %5d %9ld %10.1f %6.1f %6.3f   %-31s   %-31s\n", names[c], n, u, u / seconds,
+               totalCpu ? 100.0 * cpu / totalCpu : 0.0, sumSq > 0 ? sum * sum / (n * sumSq) : 1.0,
+               lat, blk);
+        if (perfFile != NULL)
+            fprintf(perfFile, "LOAD %s %d %ld %d %lld %lld %lld\n", names[c], n, u,
+                    totalCpu ? (int)(1000 * cpu / totalCpu) : 0, percentile(&readyLat[c], 50),
+                    percentile(&readyLat[c], 90), percentile(&readyLat[c], 99));
+    }
+
+    printf("\ntotal %ld units, %.1f units/s, CPU busy %.1f%%\n", totalUnits, totalUnits / seconds,
+           seconds > 0 ? 100.0 * totalCpu / now : 0.0);
+
+    printf("accounting: %u records written, %u lost; %ld blocks seen by flash, exits normal %ld "
+           "killed %ld other %ld\n", acctWritten, acctLost, acctBlocks, acctExits[EXITNORMAL],
+           acctExits[EXITKILLED], acctExits[EXITBADSYSCALL] + acctExits[EXITNOSUPPORT] + acctExits[EXITFAULT]);
+
+    /* Read the shared page the way a process would */
+    do
+    {
+        seq = kernelPage.kp_seq;
+        kp = kernelPage;
+    } while ((seq & 1) || seq != kernelPage.kp_seq);
+    printf("shared page at %p: seq %u, %u dispatches, %u ticks, last pid %u\n", (void *)&kernelPage,
+           kp.kp_seq, kp.kp_switches, kp.kp_ticks, kp.kp_pid);
+
+    printf("kernel log: %ld characters sent, %u messages dropped\n", klogChars, klogDropped);
+
+    printf("kernel pools (size/in use/high water/failures):");
+    for (c = 0; c < NUMPOOLS; c++)
+        printf("  %s %u/%u/%u/%u", poolNames[c], poolStats[c].ps_size, poolStats[c].ps_inUse,
+               poolStats[c].ps_highWater, poolStats[c].ps_failures);
+    printf("\n");
+
+    printf("slab caches (objects per slab/slabs/empty):");
+    for (cache = kcacheList; cache != NULL; cache = cache->kc_next)
+        printf("  %s %d/%u/%u", cache->kc_name, cache->kc_perSlab, cache->kc_slabs, cache->kc_emptySlabs);
+    printf("\n");
+
+    getPageStats(&pages);
+    printf("page allocator: %u/%u pages free, largest block %u, %u splits %u merges, free blocks by order",
+           pages.pa_free, pages.pa_pages, pages.pa_largest, pages.pa_splits, pages.pa_merges);
+    for (c = 0; c < PAGEORDERS; c++)
+        printf(" %u", pages.pa_blocks[c]);
+    printf("\n");
+
+    getLoadStats(&load);
+    printf("load average %.2f %.2f %.2f over %u ticks, ready queue depth histogram",
+           (double)load.ls_load[0] / (1 << LOADFSHIFT), (double)load.ls_load[1] / (1 << LOADFSHIFT),
+           (double)load.ls_load[2] / (1 << LOADFSHIFT), load.ls_ticks);
+    for (c = 0; c < RQHISTBUCKETS; c++)
+        printf(" %u", load.ls_rqHist[c]);
+    printf("\n");
+
+    reportSemStats();
+    reportProfile();
+}
+
+HIDDEN void usage()
+{
+    fprintf(stderr, "usage: hostsim [-c cpu] [-i io] [-l lock] [-L locks] [-u units] "
+                    "[-k kcost] [-S bytes] [-t ms] [-s seed] [-w file] [-K file] [-P file]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    progName = argv[0];
+    for (i = 1; i < argc; i++)
+    {
+        int v;
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 >= argc)
+            usage();
+        v = atoi(argv[i + 1]);
+        switch (argv[i][1])
+        {
+        case 'w':
+            waitFile = fopen(argv[i + 1], "w");
+            if (waitFile == 0)
+            {
+                perror(argv[i + 1]);
+                exit(1);
+            }
+            break;
+        case 'K':
+            klogFile = fopen(argv[i + 1], "w");
+            if (klogFile == 0)
+            {
+                perror(argv[i + 1]);
+                exit(1);
+            }
+            break;
+        case 'P':
+            perfFile = fopen(argv[i + 1], "w");
+            if (perfFile == 0)
+            {
+                perror(argv[i + 1]);
+                exit(1);
+            }
+            break;
+        case 'c': nCpu = v; break;
+        case 'i': nIo = v; break;
+        case 'l': nLock = v; break;
+        case 'L': nLocks = v < 1 ? 1 : MIN(v, MAXLOCKS); break;
+        case 'u': units = v; break;
+        case 'k': kernelCost = v; break;
+        case 'S': stackSize = v; break;
+        case 't': horizon = (simtime_t)v * 1000; break;
+        case 's': seed = v; break;
+        default: usage();
+        }
+        i++;
+    }
+
+    hostInit();
+    setupWorkload();
+    run();
+    report();
+    if (waitFile != NULL)
+        fclose(waitFile);
+    if (klogFile != NULL)
+        fclose(klogFile);
+    if (perfFile != NULL)
+    {
+        fprintf(perfFile, "LOAD_DONE\n");
+        fclose(perfFile);
+    }
+    return 0;
+}
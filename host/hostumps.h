@@ -0,0 +1,53 @@
+#ifndef HOSTUMPS
+#define HOSTUMPS
+
+/************************* HOSTUMPS.H *****************************
+ *
+ *  The externals declaration file for the host-side uMPS3 mock.
+ *
+ *  The nucleus addresses the BIOS Data Page and the bus register area
+ *  through fixed physical addresses (BIOSDATAPAGE, TODLOADDR, ...).
+ *  hostInit() maps anonymous memory at exactly those addresses so the
+ *  const.h hardware macros (STCK, LDIT, RAMTOP, DEV_REG_ADDR) work
+ *  unchanged in a native x86-64 process. It also maps HOSTRAMSIZE bytes
+ *  of RAM at RAMSTART for the page allocator; the kernel image itself
+ *  stays in the host program. Host programs must be linked
+ *  with -no-pie so kernel statics (and any state_t handed to the nucleus
+ *  through 32-bit registers) stay below that window.
+ *
+ *  The nucleus never returns to its caller: it leaves through LDST,
+ *  LDCXT, WAIT, HALT or PANIC. A harness that drives nucleus code
+ *  registers a jmp_buf with hostCatchExits(); those primitives then
+ *  longjmp back to it with one of the HOSTxxx codes below. Without a
+ *  registered jmp_buf they abort the program.
+ *
+ *  A device the nucleus polls (shutdown flushes spin on a BUSY status)
+ *  is modelled from a watcher registered with hostWatchBus(): it runs
+ *  after every nucleus access to the bus register page.
+ *
+ */
+
+#include <setjmp.h>
+#include "../h/types.h"
+
+#ifndef HOSTRAMSIZE
+#define HOSTRAMSIZE 0x00400000 /* RAM mapped at RAMSTART and reported through RAMBASESIZE */
+#endif
+
+/* Reasons the nucleus gave the CPU back to the harness */
+#define HOSTLDST  1 /* LDST: resume the state at hostResumed */
+#define HOSTLDCXT 2 /* LDCXT: pass up to the support level */
+#define HOSTWAIT  3 /* WAIT: idle until the next interrupt */
+#define HOSTHALT  4 /* HALT: orderly shutdown */
+#define HOSTPANIC 5 /* PANIC: nucleus detected a fatal condition */
+
+extern state_t *hostResumed; /* state passed to the last LDST */
+
+extern void hostInit();
+extern void hostSetTOD(unsigned int tod);
+extern void hostCatchExits(jmp_buf env);
+extern void hostWatchBus(void (*watcher)(unsigned int addr));
+
+/******************************************************************/
+
+#endif
@@ -0,0 +1,229 @@
+/************************** libumps.c (host) ******************************
+ *
+ * Host-side implementation of the libumps primitives and of the uMPS3
+ * memory-mapped hardware that the nucleus touches directly.
+ *
+ * hostInit() maps the BIOS Data Page and the bus register area at their
+ * real physical addresses, and HOSTRAMSIZE bytes of RAM at RAMSTART,
+ * and fills in the registers the nucleus reads (RAM base/size, time
+ * scale). The CP0 accessors only remember the last value written.
+ * Control-transfer primitives (LDST, LDCXT, HALT, PANIC, WAIT) longjmp
+ * back to the harness registered with hostCatchExits(), or abort the
+ * host program when there is none.
+ *
+ * hostWatchBus() lets a harness model devices that the nucleus polls.
+ * The bus register page is made inaccessible; each access faults, is
+ * let through and single-stepped (the x86-64 trap flag), and the
+ * watcher then runs with the address touched and the access done.
+ ***************************************************************/
+
+#define _GNU_SOURCE /* REG_EFL */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#undef NULL
+#include "../h/types.h"
+#include "../h/const.h"
+#include "hostumps.h"
+#include "umps3/umps/libumps.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define HWBASE BIOSDATAPAGE /* first mapped byte: BIOS Data Page */
+#define HWSIZE 0x2000       /* BIOS Data Page + bus register page */
+#define BUSPAGE ((char *)HWBASE + PAGESIZE)
+#define TRAPFLAG 0x100      /* EFLAGS.TF: trap after the next instruction */
+
+/* Emulated CP0 registers */
+static unsigned int cp0Index, cp0EntryLo, cp0EntryHi, cp0Status, cp0Cause, cp0Timer;
+
+/* Harness re-entry point for control-transfer primitives */
+static jmp_buf *exitEnv = NULL;
+
+state_t *hostResumed = NULL;
+
+/* Bus watch: the watcher and the register the current access touched */
+static void (*busWatcher)(unsigned int addr) = NULL;
+static unsigned int busAddr;
+
+/**
+ * Maps the fixed hardware window and the RAM and loads sane bus register
+ * values. Must be called before any nucleus code runs.
+ */
+void hostInit()
+{
+    void *hw = mmap((void *)HWBASE, HWSIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    void *ram = mmap((void *)RAMSTART, HOSTRAMSIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (hw == MAP_FAILED || hw != (void *)HWBASE)
+    {
+        fprintf(stderr, "hostInit: cannot map hardware window at 0x%08x\n", HWBASE);
+        exit(1);
+    }
+    if (ram == MAP_FAILED || ram != (void *)RAMSTART)
+    {
+        fprintf(stderr, "hostInit: cannot map RAM at 0x%08x\n", RAMSTART);
+        exit(1);
+    }
+
+    *(unsigned int *)RAMBASEADDR = RAMSTART;
+    *(unsigned int *)RAMBASESIZE = HOSTRAMSIZE;
+    *(unsigned int *)TIMESCALEADDR = 1; /* 1 TOD tick per microsecond */
+    *(unsigned int *)TODLOADDR = 0;
+}
+
+/**
+ * Sets the TOD-LO register seen by STCK.
+ */
+void hostSetTOD(unsigned int tod)
+{
+    *(unsigned int *)TODLOADDR = tod;
+}
+
+unsigned int getINDEX(void) { return cp0Index; }
+unsigned int getRANDOM(void) { return 0; }
+unsigned int getENTRYLO(void) { return cp0EntryLo; }
+unsigned int getBADVADDR(void) { return 0; }
+unsigned int getENTRYHI(void) { return cp0EntryHi; }
+unsigned int getSTATUS(void) { return cp0Status; }
+unsigned int getCAUSE(void) { return cp0Cause; }
+unsigned int getEPC(void) { return 0; }
+unsigned int getPRID(void) { return 0; }
+unsigned int getTIMER(void) { return cp0Timer; }
+
+unsigned int setINDEX(unsigned int index) { return cp0Index = index; }
+unsigned int setENTRYLO(unsigned int entry) { return cp0EntryLo = entry; }
+unsigned int setENTRYHI(unsigned int entry) { return cp0EntryHi = entry; }
+unsigned int setSTATUS(unsigned int entry) { return cp0Status = entry; }
+unsigned int setCAUSE(unsigned int cause) { return cp0Cause = cause; }
+unsigned int setTIMER(unsigned int timer) { return cp0Timer = timer; }
+
+void TLBWR(void) {}
+void TLBWI(void) {}
+void TLBP(void) {}
+void TLBR(void) {}
+void TLBCLR(void) {}
+
+/**
+ * Registers the jmp_buf that control-transfer primitives return to.
+ * Passing NULL restores the default (abort) behaviour.
+ */
+void hostCatchExits(jmp_buf env)
+{
+    exitEnv = (jmp_buf *)env;
+}
+
+/**
+ * Leaves the nucleus: back to the harness if one is registered,
+ * otherwise the primitive cannot be emulated and the program aborts.
+ */
+static void leaveNucleus(int why, const char *what)
+{
+    if (exitEnv != NULL)
+        longjmp(*exitEnv, why);
+
+    fprintf(stderr, "host libumps: %s is not supported natively\n", what);
+    abort();
+}
+
+void WAIT(void) { leaveNucleus(HOSTWAIT, "WAIT"); }
+void PANIC(void) { leaveNucleus(HOSTPANIC, "PANIC"); }
+
+void HALT(void)
+{
+    if (exitEnv == NULL)
+        exit(0);
+    leaveNucleus(HOSTHALT, "HALT");
+}
+
+void LDCXT(unsigned int stackPtr, unsigned int status, unsigned int pc)
+{
+    leaveNucleus(HOSTLDCXT, "LDCXT");
+}
+
+void LDST(void *statep)
+{
+    hostResumed = (state_t *)statep;
+    leaveNucleus(HOSTLDST, "LDST");
+}
+
+void STST(void *statep) { leaveNucleus(HOSTPANIC, "STST"); }
+
+unsigned int SYSCALL(unsigned int number, unsigned int arg1,
+                     unsigned int arg2, unsigned int arg3)
+{
+    leaveNucleus(HOSTPANIC, "SYSCALL");
+    return 0;
+}
+
+unsigned int CAS(unsigned int *atomic, unsigned int ov, unsigned int nv)
+{
+    if (*atomic != ov)
+        return 0;
+    *atomic = nv;
+    return 1;
+}
+
+/**
+ * SIGSEGV on the bus page while it is watched: opens the page and
+ * single-steps the faulting access. Other faults are real ones.
+ */
+static void busFault(int sig, siginfo_t *info, void *context)
+{
+    char *addr = info->si_addr;
+
+    if (busWatcher == NULL || addr < BUSPAGE || addr >= BUSPAGE + PAGESIZE)
+    {
+        signal(SIGSEGV, SIG_DFL); /* The access faults again, for good */
+        return;
+    }
+    busAddr = (unsigned int)(unsigned long)addr;
+    mprotect(BUSPAGE, PAGESIZE, PROT_READ | PROT_WRITE);
+    ((ucontext_t *)context)->uc_mcontext.gregs[REG_EFL] |= TRAPFLAG;
+}
+
+/**
+ * SIGTRAP after the access: runs the watcher and closes the page again.
+ */
+static void busStep(int sig, siginfo_t *info, void *context)
+{
+    ((ucontext_t *)context)->uc_mcontext.gregs[REG_EFL] &= ~TRAPFLAG;
+    if (busWatcher == NULL)
+        return;
+    busWatcher(busAddr);
+    mprotect(BUSPAGE, PAGESIZE, PROT_NONE);
+}
+
+/**
+ * Calls watcher after every access to the bus register page (device
+ * and timer registers), with the address accessed, until called with
+ * NULL. The harness itself must not touch the page while it is
+ * watched, except from the watcher.
+ */
+void hostWatchBus(void (*watcher)(unsigned int addr))
+{
+    static int installed = 0;
+    struct sigaction sa;
+
+    if (!installed)
+    {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_flags = SA_SIGINFO;
+        sa.sa_sigaction = busFault;
+        sigaction(SIGSEGV, &sa, 0);
+        sa.sa_sigaction = busStep;
+        sigaction(SIGTRAP, &sa, 0);
+        installed = 1;
+    }
+    busWatcher = watcher;
+    mprotect(BUSPAGE, PAGESIZE, watcher != NULL ? PROT_NONE : PROT_READ | PROT_WRITE);
+}
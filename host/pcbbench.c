@@ -0,0 +1,192 @@
+/************************** pcbbench.c ******************************
+ *
+ * Host-native micro-benchmark for the Phase 1 data structures.
+ *
+ * Links the real phase2/pcb.c and phase2/asl.c (with the slab and page
+ * allocators they draw from) against the host libumps mock and times
+ * the queue and ASL primitives with every pcb of a MAXPROC-sized pool
+ * in play. MAXPROC is a compile-time constant, so the
+ * Makefile builds one binary per size (pcbbench-<MAXPROC>) and runs them
+ * in turn; each prints one row of the ns/op table.
+ *
+ * Every measurement runs against a full structure: all MAXPROC pcbs sit
+ * in one process queue (or each on its own semaphore in the ASL), and a
+ * batch of randomly chosen pcbs is taken out and put back. The structure
+ * size therefore stays close to MAXPROC, so the numbers reflect the cost
+ * at that population rather than an average over a filling structure.
+ *
+ * Operations measured:
+ * - insertProcQ:   append a pcb to the full process queue.
+ * - outProcQ:      remove a pcb from an arbitrary queue position.
+ * - insertBlocked: block a pcb on its own (inactive) semaphore.
+ * - removeBlocked: V one of the active semaphores.
+ * - outBlocked:    pull a pcb out of the ASL directly.
+ *
+ * Usage: pcbbench-<n> [-n]      -n suppresses the table header
+ ***************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#undef NULL
+#include "../h/pcb.h"
+#include "../h/asl.h"
+#include "../h/palloc.h"
+#include "../h/const.h"
+#include "hostumps.h"
+
+#define MINROUNDNS 2.0e8 /* keep repeating a measurement for at least 200ms */
+#define BATCH MIN(MAXPROC, 256) /* pcbs cycled out and back in per round */
+
+HIDDEN pcb_PTR pcbs[MAXPROC]; /* every pcb of the pool */
+HIDDEN int sems[MAXPROC];     /* one semaphore per pcb */
+HIDDEN int order[MAXPROC];    /* permutation; first BATCH entries are the picks */
+
+HIDDEN unsigned int seed = 12345;
+
+/**
+ * Small deterministic LCG so runs are comparable between builds.
+ */
+HIDDEN unsigned int nextRand()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+/**
+ * Partial Fisher-Yates: moves BATCH fresh random indices to the front
+ * of order[] in O(BATCH).
+ */
+HIDDEN void pickBatch()
+{
+    int i;
+    for (i = 0; i < BATCH; i++)
+    {
+        int j = i + ((nextRand() << 15) | nextRand()) % (MAXPROC - i);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+HIDDEN double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1.0e9 + ts.tv_nsec;
+}
+
+/**
+ * One round of process queue traffic against the full queue *tp.
+ * Adds the elapsed time of each phase to the matching accumulator.
+ */
+HIDDEN void procQRound(pcb_PTR *tp, double *insNs, double *outNs)
+{
+    double t0;
+    int i;
+
+    pickBatch();
+    t0 = nowNs();
+    for (i = 0; i < BATCH; i++)
+        outProcQ(tp, pcbs[order[i]]);
+    *outNs += nowNs() - t0;
+
+    t0 = nowNs();
+    for (i = 0; i < BATCH; i++)
+        insertProcQ(tp, pcbs[order[i]]);
+    *insNs += nowNs() - t0;
+}
+
+/**
+ * One round of ASL traffic with every pcb blocked on its own semaphore.
+ */
+HIDDEN void aslRound(double *insNs, double *remNs, double *outNs)
+{
+    double t0;
+    int i;
+
+    pickBatch();
+    t0 = nowNs();
+    for (i = 0; i < BATCH; i++)
+        removeBlocked(&sems[order[i]]);
+    *remNs += nowNs() - t0;
+
+    t0 = nowNs();
+    for (i = 0; i < BATCH; i++)
+        insertBlocked(&sems[order[i]], pcbs[order[i]]);
+    *insNs += nowNs() - t0;
+
+    pickBatch();
+    t0 = nowNs();
+    for (i = 0; i < BATCH; i++)
+        outBlocked(pcbs[order[i]]);
+    *outNs += nowNs() - t0;
+
+    for (i = 0; i < BATCH; i++)
+        insertBlocked(&sems[order[i]], pcbs[order[i]]);
+}
+
+int main(int argc, char *argv[])
+{
+    double insQ = 0, outQ = 0, insB = 0, remB = 0, outB = 0;
+    double qOps = 0, bOps = 0;
+    pcb_PTR tp = mkEmptyProcQ();
+    int i;
+
+    hostInit();
+    initPages();
+    initPcbs();
+    initASL();
+
+    for (i = 0; i < MAXPROC; i++)
+    {
+        pcbs[i] = allocPcb();
+        if (pcbs[i] == NULL)
+        {
+            fprintf(stderr, "pcbbench: pcb pool exhausted at %d\n", i);
+            return 1;
+        }
+        order[i] = i;
+    }
+
+    /* Process queue: fill, then cycle batches through it */
+    for (i = 0; i < MAXPROC; i++)
+        insertProcQ(&tp, pcbs[i]);
+
+    do
+    {
+        procQRound(&tp, &insQ, &outQ);
+        qOps += BATCH;
+    } while (insQ + outQ < MINROUNDNS);
+
+    while (!emptyProcQ(tp))
+        removeProcQ(&tp);
+
+    /* ASL: block every pcb on its own semaphore, then cycle batches */
+    for (i = 0; i < MAXPROC; i++)
+    {
+        if (insertBlocked(&sems[i], pcbs[i]))
+        {
+            fprintf(stderr, "pcbbench: semd pool exhausted at %d\n", i);
+            return 1;
+        }
+    }
+
+    do
+    {
+        aslRound(&insB, &remB, &outB);
+        bOps += BATCH;
+    } while (insB + remB + outB < MINROUNDNS);
+
+    if (argc < 2 || strcmp(argv[1], "-n") != 0)
+        printf("%8s %13s %13s %13s %13s %13s   (ns/op)\n", "MAXPROC",
+               "insertProcQ", "outProcQ", "insertBlocked", "removeBlocked", "outBlocked");
+
+    printf("%8d %13.1f %13.1f %13.1f %13.1f %13.1f\n", MAXPROC,
+           insQ / qOps, outQ / qOps, insB / bOps, remB / bOps, outB / bOps);
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+#!/bin/sh
+#
+# perfrun.sh -- headless performance regression runner
+#
+# Boots each benchmark image (benchkernel, loadkernel, stresskernel, ...)
+# in uMPS3 without a display, collects the BENCH/LOAD lines the image
+# prints on Terminal0 and compares them with a stored baseline.
+#
+#   perfrun.sh [-u] [-H] [-b baseline] [-t tolerance] [-w workdir] image ...
+#
+#   -u            record the results as the new baseline instead
+#   -H            the images are host programs instead (see below)
+#   -b baseline   baseline file (default perf.baseline)
+#   -t tolerance  default allowed slowdown in percent (default 10)
+#   -w workdir    where machine configs and device files go (default perf)
+#
+# With -H an image is a host program in the current directory that
+# takes -P <file> and writes BENCH/LOAD lines and a *_DONE line there,
+# such as hostsim, which runs the real nucleus in simulated time. It is
+# run as ./<image> $PERFHOSTARGS -P <file>. Its figures depend on the
+# nucleus alone, not on the speed of the box, so one baseline serves
+# every Linux machine; this is what make perfcheck runs.
+#
+# An image is the name of a kernel built with elf2umps -k: the runner
+# needs <image>.core.umps and <image>.stab.umps in the current directory.
+# For every image a machine configuration is generated in workdir/<image>
+# with Terminal0/1, Printer0 and Disk0 backed by files there; the
+# emulator runs until the image prints its *_DONE line or PERFTIMEOUT
+# seconds pass.
+#
+# uMPS3 has no batch mode: it is started as $UMPS3_CMD <config> with
+# QT_QPA_PLATFORM=offscreen and must power the machine on by itself,
+# which stock uMPS3 does not do. Emulator runs (make perfcheck-umps)
+# therefore need UMPS3_CMD to name a uMPS3 build patched to start the
+# machine on load; no such wrapper ships here.
+#
+# Metrics, one per line ("<image>.<name> <value>"):
+#   BENCH <name> <n> <total_us> <per_op_us>
+#       -> <name>: total_us / n, lower is better
+#   LOAD <class> <procs> <units> <cpu_permille> <p50> <p90> <p99>
+#       -> <class>.units, higher is better; <class>.p50, <class>.p99
+#          lower is better
+#
+# Baseline lines are "<metric> <value> [tolerance]"; '#' starts a comment.
+# The exit status is 1 if any metric regressed beyond its tolerance or an
+# image did not finish.
+#
+
+UMPS3_CMD=${UMPS3_CMD:-umps3}
+UMPS3_DIR_PREFIX=${UMPS3_DIR_PREFIX:-/usr}
+SUPDIR=${SUPDIR:-$UMPS3_DIR_PREFIX/share/umps3}
+PERFTIMEOUT=${PERFTIMEOUT:-300}
+
+update=0
+host=0
+baseline=perf.baseline
+tolerance=10
+workdir=perf
+
+while getopts uHb:t:w: opt; do
+    case $opt in
+    u) update=1 ;;
+    H) host=1 ;;
+    b) baseline=$OPTARG ;;
+    t) tolerance=$OPTARG ;;
+    w) workdir=$OPTARG ;;
+    *) echo "usage: $0 [-u] [-H] [-b baseline] [-t tolerance] [-w workdir] image ..." >&2
+       exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+    echo "$0: no image given" >&2
+    exit 2
+fi
+
+here=$(pwd)
+results=$workdir/results
+status=0
+
+mkdir -p "$workdir" || exit 2
+: > "$results"
+
+# writes the uMPS3 machine configuration for image $1 into $2
+genconfig() {
+    case $1 in
+    stress*) ramsize=512 ;;   # thousands of stacks and pcbs
+    *) ramsize=${PERFRAMSIZE:-128} ;;
+    esac
+
+    cat > "$2/machine.json" <<EOF
+{
+    "num-processors": 1,
+    "clock-rate": 1,
+    "ram-size": $ramsize,
+    "tlb-size": 16,
+    "tlb-floor-address": "0x80000000",
+    "bootstrap-rom": "$SUPDIR/coreboot.rom.umps",
+    "execution-rom": "$SUPDIR/exec.rom.umps",
+    "boot": {
+        "load-core-file": true,
+        "core-file": "$here/$1.core.umps"
+    },
+    "symbol-table": {
+        "asid": 64,
+        "file": "$here/$1.stab.umps"
+    },
+    "devices": {
+        "terminal0": { "enabled": true, "file": "$2/term0.umps" },
+        "terminal1": { "enabled": true, "file": "$2/term1.umps" },
+        "printer0": { "enabled": true, "file": "$2/printer0.umps" },
+        "disk0": { "enabled": true, "file": "$2/disk0.umps" }
+    }
+}
+EOF
+}
+
+# turns the BENCH/LOAD lines of file $2 into metrics of image $1
+metrics() {
+    awk -v img="$1" '
+        $1 == "BENCH" && NF == 5 && $3 > 0 { printf "%s.%s %.3f\n", img, $2, $4 / $3 }
+        $1 == "LOAD" && NF == 8 {
+            printf "%s.%s.units %d\n", img, $2, $4
+            printf "%s.%s.p50 %d\n", img, $2, $6
+            printf "%s.%s.p99 %d\n", img, $2, $8
+        }' "$2" >> "$results"
+}
+
+# runs host program $1 and appends its metrics to $results
+runhost() {
+    dir=$workdir/$1
+    mkdir -p "$dir"
+    rm -f "$dir/results.out"
+
+    if [ ! -x "./$1" ]; then
+        echo "FAIL $1: ./$1 not found"
+        return 1
+    fi
+    # shellcheck disable=SC2086
+    if ! "./$1" $PERFHOSTARGS -P "$dir/results.out" > "$dir/$1.log" 2>&1 ||
+        ! grep -q '_DONE' "$dir/results.out" 2> /dev/null; then
+        echo "FAIL $1: no *_DONE line (see $dir)"
+        return 1
+    fi
+    metrics "$1" "$dir/results.out"
+}
+
+# boots image $1 and appends its metrics to $results
+runimage() {
+    dir=$workdir/$1
+    mkdir -p "$dir"
+    rm -f "$dir"/term0.umps "$dir"/term1.umps "$dir"/printer0.umps
+
+    if [ ! -f "$1.core.umps" ]; then
+        echo "FAIL $1: $1.core.umps not found"
+        return 1
+    fi
+    if [ ! -f "$dir/disk0.umps" ]; then
+        umps3-mkdev -d "$dir/disk0.umps" > /dev/null 2>&1 ||
+            echo "warning: cannot create $dir/disk0.umps, disk readers stay idle"
+    fi
+    : > "$dir/term0.umps"
+    genconfig "$1" "$dir"
+
+    QT_QPA_PLATFORM=offscreen $UMPS3_CMD "$dir/machine.json" > "$dir/umps3.log" 2>&1 &
+    pid=$!
+
+    waited=0
+    while ! grep -q '_DONE' "$dir/term0.umps" 2> /dev/null; do
+        if ! kill -0 $pid 2> /dev/null || [ $waited -ge "$PERFTIMEOUT" ]; then
+            kill $pid 2> /dev/null
+            wait $pid 2> /dev/null
+            echo "FAIL $1: no *_DONE line after ${waited}s (see $dir)"
+            return 1
+        fi
+        sleep 1
+        waited=$((waited + 1))
+    done
+    kill $pid 2> /dev/null
+    wait $pid 2> /dev/null
+
+    metrics "$1" "$dir/term0.umps"
+}
+
+for image in "$@"; do
+    if [ $host -eq 1 ]; then
+        runhost "$image" || status=1
+    else
+        runimage "$image" || status=1
+    fi
+done
+
+if [ $update -eq 1 ]; then
+    {
+        echo "# perfrun.sh baseline, recorded $(date '+%Y-%m-%d')"
+        echo "# <metric> <value> [tolerance in percent]"
+        cat "$results"
+    } > "$baseline"
+    echo "baseline written to $baseline ($(wc -l < "$results") metrics)"
+    exit $status
+fi
+
+if [ ! -f "$baseline" ]; then
+    echo "no baseline $baseline: record one with -u"
+    cat "$results"
+    exit 1
+fi
+
+# units metrics must not drop, everything else must not grow
+awk -v deftol="$tolerance" '
+    FNR == NR {
+        if ($0 ~ /^#/ || NF < 2)
+            next
+        base[$1] = $2
+        tol[$1] = (NF >= 3) ? $3 : deftol
+        next
+    }
+    {
+        seen[$1] = 1
+        if (!($1 in base)) {
+            printf "NEW  %-40s %12s\n", $1, $2
+            next
+        }
+        b = base[$1]; v = $2
+        delta = (b != 0) ? (v - b) * 100 / b : 0
+        if ($1 ~ /\.units$/)
+            bad = (v < b * (1 - tol[$1] / 100))
+        else
+            bad = (v > b * (1 + tol[$1] / 100))
+        printf "%s %-40s %12s %12s %+7.1f%%\n", bad ? "FAIL" : "PASS", $1, b, v, delta
+        if (bad)
+            failed++
+    }
+    END {
+        for (m in base) {
+            if (!(m in seen)) {
+                printf "MISS %-40s %12s\n", m, base[m]
+                failed++
+            }
+        }
+        printf "%d regression(s)\n", failed
+        exit failed > 0
+    }' "$baseline" "$results" || status=1
+
+exit $status
@@ -0,0 +1,52 @@
+#ifndef UMPS_LIBUMPS_H
+#define UMPS_LIBUMPS_H
+
+/************************* LIBUMPS.H (host stub) *****************************
+ *
+ *  Host-side stand-in for the uMPS3 libumps interface.
+ *
+ *  Only used when nucleus modules are compiled natively (see ../host and
+ *  the host targets in phase2/Makefile). The prototypes mirror the real
+ *  libumps.h so kernel sources build unchanged; the implementations live
+ *  in host/libumps.c.
+ *
+ */
+
+extern unsigned int getINDEX(void);
+extern unsigned int getRANDOM(void);
+extern unsigned int getENTRYLO(void);
+extern unsigned int getBADVADDR(void);
+extern unsigned int getENTRYHI(void);
+extern unsigned int getSTATUS(void);
+extern unsigned int getCAUSE(void);
+extern unsigned int getEPC(void);
+extern unsigned int getPRID(void);
+extern unsigned int getTIMER(void);
+
+extern unsigned int setINDEX(unsigned int index);
+extern unsigned int setENTRYLO(unsigned int entry);
+extern unsigned int setENTRYHI(unsigned int entry);
+extern unsigned int setSTATUS(unsigned int entry);
+extern unsigned int setCAUSE(unsigned int cause);
+extern unsigned int setTIMER(unsigned int timer);
+
+extern void TLBWR(void);
+extern void TLBWI(void);
+extern void TLBP(void);
+extern void TLBR(void);
+extern void TLBCLR(void);
+
+extern void WAIT(void);
+extern void HALT(void);
+extern void PANIC(void);
+
+extern void LDCXT(unsigned int stackPtr, unsigned int status, unsigned int pc);
+extern void LDST(void *statep);
+extern void STST(void *statep);
+extern unsigned int SYSCALL(unsigned int number, unsigned int arg1,
+                            unsigned int arg2, unsigned int arg3);
+extern unsigned int CAS(unsigned int *atomic, unsigned int ov, unsigned int nv);
+
+/*****************************************************************************/
+
+#endif
@@ -0,0 +1,686 @@
+/************************** vmtest.c ******************************
+ *
+ * Host-side regression driver for the nucleus' memory services: the
+ * pager (pager.c), copy-on-write FORKPROCESS, shared segments (shm.c),
+ * sharing of swap blocks between address spaces, and the compressed
+ * RAM tier in front of the swap flash (zpool.c).
+ *
+ * Like hostsim, it links the real nucleus against the libumps mock and
+ * plays the CPU. A process is identified by register s0 of its state
+ * (the root process, which the driver acts for, has s0 == 0); SYSCALLs,
+ * TLB exceptions and interrupts enter the nucleus through
+ * exceptionHandler() with the BIOS Data Page filled in, and a process
+ * is brought to the CPU by Process Local Timer interrupts until the
+ * scheduler dispatches it. There is no TLB: a memory access checks the
+ * process' page table entry, raises a TLB-Invalid exception if it has
+ * no V and a TLB-Modification one for a write without D, and once the
+ * entry allows it goes to the RAM the entry maps. The swap flash
+ * SWAPFLASHDEV is an array of blocks; a command completes, possibly
+ * with a write error, when the driver next has to wait for it.
+ *
+ * The scenario, checked against GETPAGERSTATS (counters and the frame
+ * and swap block gauges) and the kernel pools after each step:
+ * - SYS1 refuses a support structure in use, leaving its stack page
+ *   alone, and reads 0 as none.
+ * - A process writes more pages than there are frames, so they are
+ *   evicted to the RAM pool or the flash, and reads them and a program
+ *   image on the flash back in.
+ * - It forks (not while it has a plain writable page); the child's
+ *   write to a shared page gets a copy of its own.
+ * - A second process running the same image maps the frames already
+ *   holding its text instead of reading the blocks again.
+ * - Parent and child share a segment.
+ * - A write-back fails: the page stays with its owners and the process
+ *   the frame was for is terminated.
+ * - Everybody terminates, which must leave no frame, block, mapping
+ *   record, segment or pool chunk behind.
+ *
+ * Usage: vmtest [-v]
+ *   -v   print the pager statistics after each step
+ * Exits with 0 if every check passed, 1 if one failed, 2 if the nucleus
+ * got stuck or left the CPU in an unexpected way.
+ ***************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#undef NULL
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#define main nucleusMain /* initial.c is built with -Dmain=nucleusMain */
+#include "../h/initial.h"
+#undef main
+#include "../h/exceptions.h"
+#include "../h/pager.h"
+#include "hostumps.h"
+
+#define SYSEXCCODE 8 /* Cause.ExcCode of a SYSCALL */
+#define TLBLEXC    2 /* Cause.ExcCode of a TLB-Invalid exception on a load */
+#define TLBSEXC    3 /* ... and on a store */
+#define PLTLINE    1 /* Interrupt line of the Process Local Timer */
+#define WRITEERR   5 /* Flash status: write error */
+
+#define IDLEPID  -1
+#define ROOT     0
+#define NPROCS   5
+#define MAXSTEPS 1000 /* Nucleus entries a process may take to get the CPU */
+
+/* Address space layout of the test processes (page table indices) */
+#define DATAPAGES  20 /* Zero-filled writable pages from 0 */
+#define TEXTIDX    24 /* Program image: TEXTPAGES read-only pages ... */
+#define TEXTPAGES  4  /* ... from swap blocks 0.. */
+#define SHMIDX     28 /* Two-page shared segment */
+#define PLAINIDX   30 /* Writable page that is not the pager's */
+#define SWAPBLOCKS 64
+
+HIDDEN unsigned int swapStore[SWAPBLOCKS][PAGESIZE / sizeof(unsigned int)];
+HIDDEN int failWrites = 0; /* Flash writes left to fail */
+
+/* What the driver hands to the nucleus (statics, so their addresses fit
+   in 32-bit registers) */
+HIDDEN support_t sups[NPROCS];
+HIDDEN state_t procStates[NPROCS];
+HIDDEN pagerstat_t pgStats;
+
+HIDDEN state_t cpuState;  /* Registers of the running process */
+HIDDEN state_t idleState; /* What the CPU "saves" when interrupted in WAIT */
+HIDDEN int running = IDLEPID;
+HIDDEN pcb_PTR rootProc;
+HIDDEN jmp_buf kernelExit;
+
+HIDDEN int checks = 0, failures = 0;
+HIDDEN int verbose = 0;
+
+/* Referenced by initial.c: the root process starts at test() */
+void test() {}
+
+#define CHECK(c) check((c), #c, __LINE__)
+
+HIDDEN void check(int ok, char *what, int line)
+{
+    checks++;
+    if (!ok)
+    {
+        failures++;
+        fprintf(stderr, "vmtest:%d: check failed: %s\n", line, what);
+    }
+}
+
+HIDDEN void fatal(char *what, int pid)
+{
+    fprintf(stderr, "vmtest: %s (pid %d)\n", what, pid);
+    exit(2);
+}
+
+/*********************** The simulated CPU ***********************/
+
+/**
+ * Runs nucleus code until it gives the CPU back, and notes which
+ * process (if any) it resumed.
+ */
+HIDDEN void enterKernel(void (*entry)())
+{
+    int why = setjmp(kernelExit);
+
+    if (why == 0)
+    {
+        hostCatchExits(kernelExit);
+        entry();
+        fatal("nucleus returned to its caller", running);
+    }
+
+    switch (why)
+    {
+    case HOSTLDST:
+        memcpy(&cpuState, hostResumed, sizeof(state_t));
+        running = cpuState.s_s0;
+        break;
+    case HOSTWAIT:
+        running = IDLEPID;
+        break;
+    case HOSTLDCXT:
+        fatal("exception passed up", running);
+    default:
+        fatal("nucleus halted or panicked", running);
+    }
+}
+
+/**
+ * Raises an interrupt on line.
+ */
+HIDDEN void interrupt(int line)
+{
+    state_t *bios = (state_t *)BIOSDATAPAGE;
+
+    memcpy(bios, running != IDLEPID ? &cpuState : &idleState, sizeof(state_t));
+    bios->s_cause = 1 << (IPSHIFT + line); /* ExcCode 0: interrupt */
+    enterKernel(exceptionHandler);
+}
+
+/**
+ * Completes the command pending on the swap flash, if any, and raises
+ * its interrupt. Returns FALSE if there was none.
+ */
+HIDDEN int serveFlash()
+{
+    device_t *flash = DEV_REG_ADDR(FLASHINT, SWAPFLASHDEV);
+    unsigned int command = flash->d_command & 0xFF;
+    unsigned int blk = flash->d_command >> BYTELEN;
+
+    if (command != FLASHREADBLK && command != FLASHWRITEBLK)
+        return FALSE;
+
+    flash->d_status = READY;
+    if (blk >= SWAPBLOCKS)
+        fatal("flash command past the last block", running);
+    else if (command == FLASHWRITEBLK && failWrites > 0)
+    {
+        failWrites--;
+        flash->d_status = WRITEERR;
+    }
+    else if (command == FLASHWRITEBLK)
+        memcpy(swapStore[blk], (void *)flash->d_data0, PAGESIZE);
+    else
+        memcpy((void *)flash->d_data0, swapStore[blk], PAGESIZE);
+
+    *INTDEVBITMAP_ADDR(FLASHINT) |= 1 << SWAPFLASHDEV;
+    interrupt(FLASHINT);
+    *INTDEVBITMAP_ADDR(FLASHINT) &= ~(1 << SWAPFLASHDEV);
+    return TRUE;
+}
+
+/**
+ * Returns TRUE if process pid is p or one of its progeny.
+ */
+HIDDEN int inTree(pcb_PTR p, int pid)
+{
+    pcb_PTR c;
+
+    if (p->p_s.s_s0 == pid)
+        return TRUE;
+    for (c = p->p_child; c != NULL; c = c->p_sib_right)
+        if (inTree(c, pid))
+            return TRUE;
+    return FALSE;
+}
+
+/**
+ * Returns TRUE if process pid is alive.
+ */
+HIDDEN int alive(int pid)
+{
+    return inTree(rootProc, pid);
+}
+
+/**
+ * Gets process pid on the CPU: completes flash commands and preempts
+ * whoever runs until the scheduler dispatches it. Returns FALSE if it
+ * has terminated.
+ */
+HIDDEN int runProc(int pid)
+{
+    int n;
+
+    for (n = 0; running != pid; n++)
+    {
+        if (!alive(pid))
+            return FALSE;
+        if (n == MAXSTEPS)
+            fatal("process never got the CPU", pid);
+        if (!serveFlash())
+        {
+            if (running == IDLEPID)
+                fatal("process blocked for good", pid);
+            interrupt(PLTLINE);
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * Process pid executes a SYSCALL in kernel mode. Returns its v0.
+ */
+HIDDEN int doSyscall(int pid, int a0, unsigned int a1, unsigned int a2, unsigned int a3)
+{
+    state_t *bios = (state_t *)BIOSDATAPAGE;
+
+    if (!runProc(pid))
+        fatal("SYSCALL by a terminated process", pid);
+    memcpy(bios, &cpuState, sizeof(state_t));
+    bios->s_cause = SYSEXCCODE << 2;
+    bios->s_status &= KUPBITOFF;
+    bios->s_a0 = a0;
+    bios->s_a1 = a1;
+    bios->s_a2 = a2;
+    bios->s_a3 = a3;
+    enterKernel(exceptionHandler);
+    return running == pid ? cpuState.s_v0 : 0;
+}
+
+/**
+ * Process pid accesses page idx of its address space, taking the TLB
+ * exceptions the page table calls for. Returns the page, or NULL if the
+ * process was terminated meanwhile.
+ */
+HIDDEN unsigned int *touch(int pid, int idx, int write)
+{
+    state_t *bios = (state_t *)BIOSDATAPAGE;
+    pteEntry_t *pte = &sups[pid].sup_privatePgTbl[idx];
+    int n;
+
+    for (n = 0; n < MAXSTEPS; n++)
+    {
+        if (!runProc(pid))
+            return NULL;
+        if ((pte->pte_entryLO & VALIDON) && (!write || (pte->pte_entryLO & DIRTYON)))
+            return (unsigned int *)(pte->pte_entryLO & PFNMASK);
+
+        memcpy(bios, &cpuState, sizeof(state_t));
+        bios->s_entryHI = (KUSEG + idx * PAGESIZE) | (cpuState.s_entryHI & ASIDMASK);
+        if (!(pte->pte_entryLO & VALIDON))
+            bios->s_cause = (write ? TLBSEXC : TLBLEXC) << 2;
+        else
+            bios->s_cause = TLBMODEXC << 2;
+        enterKernel(exceptionHandler);
+    }
+    fatal("access never completed", pid);
+    return NULL;
+}
+
+/************************** Test data *****************************/
+
+/**
+ * Word j of data page idx: incompressible for even pages, so they go
+ * to the flash, and repetitive for odd ones, which the RAM pool takes.
+ */
+HIDDEN unsigned int dataWord(int idx, int j)
+{
+    unsigned int x;
+
+    if (idx % 2 == 1)
+        return idx * 0x01010101 + j % 8;
+    x = (idx + 1) * 0x9E3779B9 + j * 0x85EBCA6B;
+    x ^= x >> 15;
+    x *= 0xC2B2AE35;
+    return x ^ (x >> 13);
+}
+
+/**
+ * Word j of text page t, as stored in swap block t.
+ */
+HIDDEN unsigned int textWord(int t, int j)
+{
+    return 0x7E570000 | (t << 12) | j;
+}
+
+HIDDEN void fillPage(unsigned int *p, int idx)
+{
+    int j;
+
+    for (j = 0; j < PAGESIZE / sizeof(unsigned int); j++)
+        p[j] = dataWord(idx, j);
+}
+
+/**
+ * Returns TRUE if p holds data page idx, first word excepted.
+ */
+HIDDEN int isPage(unsigned int *p, int idx)
+{
+    int j;
+
+    for (j = 1; p != NULL && j < PAGESIZE / sizeof(unsigned int); j++)
+        if (p[j] != dataWord(idx, j))
+            return FALSE;
+    return p != NULL;
+}
+
+HIDDEN int isText(unsigned int *p, int t)
+{
+    int j;
+
+    for (j = 0; p != NULL && j < PAGESIZE / sizeof(unsigned int); j++)
+        if (p[j] != textWord(t, j))
+            return FALSE;
+    return p != NULL;
+}
+
+/**
+ * Sets up the page table of process pid: data zero-filled writable
+ * pages from index 0, and the program image if text is set.
+ */
+HIDDEN void setupSpace(int pid, int data, int text)
+{
+    support_t *sup = &sups[pid];
+    pteEntry_t *pte;
+    int i;
+
+    sup->sup_asid = pid;
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        pte = &sup->sup_privatePgTbl[i];
+        pte->pte_entryHI = (KUSEG + i * PAGESIZE) | (pid << ASIDSHIFT);
+        pte->pte_entryLO = 0;
+        if (i < data)
+            pte->pte_entryLO = PTEPAGED | PTEWRITABLE;
+        else if (text && i >= TEXTIDX && i < TEXTIDX + TEXTPAGES)
+            pte->pte_entryLO = PTEPAGED | PTEONFLASH | ((i - TEXTIDX) << VPNSHIFT);
+    }
+}
+
+/**
+ * Returns the PFN field of page idx of process pid.
+ */
+HIDDEN memaddr frameOf(int pid, int idx)
+{
+    return sups[pid].sup_privatePgTbl[idx].pte_entryLO & PFNMASK;
+}
+
+/**
+ * Returns the number of entries of live processes naming a swap block.
+ */
+HIDDEN unsigned int onFlash()
+{
+    unsigned int n = 0;
+    int pid, i;
+
+    for (pid = 1; pid < NPROCS; pid++)
+        for (i = 0; pagerInUse(&sups[pid]) && i < USERPGTBLSIZE; i++)
+            if (sups[pid].sup_privatePgTbl[i].pte_entryLO & PTEONFLASH)
+                n++;
+    return n;
+}
+
+/**
+ * Reads the pager statistics as process pid, into pgStats.
+ */
+HIDDEN void getStats(int pid, char *step)
+{
+    CHECK(doSyscall(pid, GETPAGERSTATS, (unsigned int)&pgStats, 0, 0) == 0);
+    if (verbose)
+        printf("%-8s faults %u soft %u zero %u in %u out %u zin %u zout %u evict %u shared %u copies %u hits %u"
+               " | frames %u maps %u blocks %u refs %u\n",
+               step, pgStats.pg_faults, pgStats.pg_softFaults, pgStats.pg_zeroFills, pgStats.pg_pageIns,
+               pgStats.pg_pageOuts, pgStats.pg_zpoolIns, pgStats.pg_zpoolOuts, pgStats.pg_evictions,
+               pgStats.pg_shared, pgStats.pg_copies, pgStats.pg_blockHits, pgStats.pg_frames, pgStats.pg_maps,
+               pgStats.pg_blocks, pgStats.pg_blockRefs);
+}
+
+/*************************** Scenario *****************************/
+
+HIDDEN void init()
+{
+    device_t *flash = DEV_REG_ADDR(FLASHINT, SWAPFLASHDEV);
+    int pid, t, j;
+
+    hostInit();
+    flash->d_status = READY;
+    flash->d_data1 = SWAPBLOCKS;
+    for (t = 0; t < TEXTPAGES; t++)
+        for (j = 0; j < PAGESIZE / sizeof(unsigned int); j++)
+            swapStore[t][j] = textWord(t, j);
+
+    for (pid = 0; pid < NPROCS; pid++)
+    {
+        procStates[pid].s_s0 = pid;
+        procStates[pid].s_status = IEPBITON | IM | TEBITON;
+        procStates[pid].s_pc = KUSEG; /* A SYS1 stack is the stack page */
+    }
+    idleState.s_s0 = IDLEPID;
+    idleState.s_status = IECON | IM;
+
+    enterKernel(nucleusMain);
+    if (running != ROOT)
+        fatal("root process not dispatched", running);
+    rootProc = currentProcess;
+}
+
+/**
+ * SYS1: the support structure argument.
+ */
+HIDDEN void testCreate()
+{
+    pteEntry_t stack;
+
+    setupSpace(1, DATAPAGES, TRUE);
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[1], (unsigned int)&sups[1], PAGESIZE) == 0);
+    stack = sups[1].sup_privatePgTbl[USERPGTBLSIZE - 1];
+    CHECK((stack.pte_entryLO & PFNMASK) != 0 && (stack.pte_entryLO & VALIDON));
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[2], (unsigned int)&sups[1], 0) == -1);
+
+    /* Refused before a stack is mapped into the owner's page table */
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[2], (unsigned int)&sups[1], PAGESIZE) == -1);
+    CHECK(sups[1].sup_privatePgTbl[USERPGTBLSIZE - 1].pte_entryHI == stack.pte_entryHI &&
+          sups[1].sup_privatePgTbl[USERPGTBLSIZE - 1].pte_entryLO == stack.pte_entryLO);
+
+    /* 0 is no support structure, like NULL */
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[4], 0, 0) == 0);
+    CHECK(!pagerInUse(&sups[4]) && runProc(4));
+    doSyscall(4, TERMINATEPROCESS, 0, 0, 0);
+    CHECK(!alive(4));
+}
+
+/**
+ * Eviction to the RAM pool and to the flash, and faulting back in.
+ */
+HIDDEN void testPaging()
+{
+    int i;
+
+    for (i = 0; i < DATAPAGES; i++)
+    {
+        unsigned int *p = touch(1, i, TRUE);
+        fillPage(p, i);
+        p[0] = 1000 + i;
+    }
+    getStats(1, "written");
+    CHECK(pgStats.pg_zeroFills == DATAPAGES);
+    CHECK(pgStats.pg_evictions >= DATAPAGES - NUMFRAMES);
+    CHECK(pgStats.pg_pageOuts > 0);
+    CHECK(pgStats.pg_zpoolOuts > 0);
+    CHECK(pgStats.pg_frames == NUMFRAMES && pgStats.pg_maps == NUMFRAMES);
+    /* Text and evicted pages: one block each, held by its entry */
+    CHECK(pgStats.pg_blocks == onFlash() && pgStats.pg_blockRefs == onFlash());
+
+    for (i = 0; i < DATAPAGES; i++)
+    {
+        unsigned int *p = touch(1, i, FALSE);
+        CHECK(isPage(p, i) && p[0] == 1000 + i);
+    }
+    for (i = 0; i < TEXTPAGES; i++)
+        CHECK(isText(touch(1, TEXTIDX + i, FALSE), i));
+    getStats(1, "read");
+    CHECK(pgStats.pg_pageIns >= TEXTPAGES);
+    CHECK(pgStats.pg_zpoolIns > 0);
+    CHECK(pgStats.pg_maps == pgStats.pg_frames);
+    CHECK(pgStats.pg_blockRefs >= pgStats.pg_blocks && pgStats.pg_blockRefs >= onFlash());
+}
+
+/**
+ * FORKPROCESS, and a write to a page shared copy-on-write.
+ */
+HIDDEN void testFork()
+{
+    pagerstat_t before;
+    unsigned int *p;
+    int i;
+
+    /* A plain writable page cannot be shared */
+    sups[1].sup_privatePgTbl[PLAINIDX].pte_entryLO = RAMSTART | VALIDON | DIRTYON;
+    CHECK(doSyscall(1, FORKPROCESS, (unsigned int)&procStates[2], (unsigned int)&sups[2], 0) == -1);
+    sups[1].sup_privatePgTbl[PLAINIDX].pte_entryLO = 0;
+    CHECK(doSyscall(1, FORKPROCESS, (unsigned int)&procStates[2], (unsigned int)&sups[1], 0) == -1);
+
+    getStats(1, "prefork");
+    before = pgStats;
+    CHECK(doSyscall(1, FORKPROCESS, (unsigned int)&procStates[2], (unsigned int)&sups[2], 0) == 0);
+    getStats(1, "fork");
+    CHECK(pgStats.pg_shared - before.pg_shared == DATAPAGES + TEXTPAGES);
+    CHECK(pgStats.pg_frames == before.pg_frames && pgStats.pg_maps == 2 * before.pg_maps);
+    CHECK(pgStats.pg_blockRefs - before.pg_blockRefs == onFlash() / 2);
+
+    /* Both see the same frame until the child writes to it */
+    CHECK(touch(1, 0, FALSE) != NULL);
+    p = touch(2, 0, FALSE);
+    CHECK(isPage(p, 0) && p[0] == 1000 && frameOf(2, 0) == frameOf(1, 0));
+    before = pgStats;
+    p = touch(2, 0, TRUE);
+    p[0] = 2000;
+    getStats(2, "cow");
+    CHECK(pgStats.pg_copies == before.pg_copies + 1);
+    CHECK(frameOf(2, 0) != frameOf(1, 0));
+    CHECK(isPage(p, 0));
+    CHECK(touch(1, 0, FALSE)[0] == 1000);
+
+    for (i = 1; i < DATAPAGES; i++)
+    {
+        p = touch(2, i, FALSE);
+        CHECK(isPage(p, i) && p[0] == 1000 + i);
+    }
+}
+
+/**
+ * A second user of the program image maps the frames holding it.
+ */
+HIDDEN void testBlockSharing()
+{
+    pagerstat_t before;
+    int t;
+
+    for (t = 0; t < TEXTPAGES; t++)
+        CHECK(isText(touch(1, TEXTIDX + t, FALSE), t));
+    setupSpace(3, 0, TRUE);
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[3], (unsigned int)&sups[3], 0) == 0);
+
+    getStats(ROOT, "preshare");
+    before = pgStats;
+    for (t = 0; t < TEXTPAGES; t++)
+    {
+        CHECK(isText(touch(3, TEXTIDX + t, FALSE), t));
+        CHECK(frameOf(3, TEXTIDX + t) == frameOf(1, TEXTIDX + t));
+    }
+    getStats(3, "share");
+    CHECK(pgStats.pg_blockHits - before.pg_blockHits == TEXTPAGES);
+    CHECK(pgStats.pg_pageIns == before.pg_pageIns);
+    CHECK(pgStats.pg_maps - before.pg_maps == TEXTPAGES);
+}
+
+/**
+ * A segment shared by parent and child.
+ */
+HIDDEN void testShm()
+{
+    memaddr va = KUSEG + SHMIDX * PAGESIZE;
+    int id;
+
+    id = doSyscall(1, SHMCREATE, 2 * PAGESIZE, va, 0);
+    CHECK(id >= 0);
+    CHECK(poolStats[POOLSHM].ps_inUse == 1);
+    touch(1, SHMIDX, TRUE)[0] = 0x5EC0;
+    touch(1, SHMIDX + 1, TRUE)[0] = 0x5EC1;
+
+    CHECK(doSyscall(2, SHMMAP, id, va, 0) == 0);
+    CHECK(touch(2, SHMIDX, FALSE)[0] == 0x5EC0);
+    CHECK(touch(2, SHMIDX + 1, FALSE)[0] == 0x5EC1);
+    CHECK(frameOf(2, SHMIDX) == frameOf(1, SHMIDX));
+    CHECK(doSyscall(2, SHMUNMAP, va, 0, 0) == 0);
+    CHECK(poolStats[POOLSHM].ps_inUse == 1);
+    CHECK(touch(1, SHMIDX, FALSE)[0] == 0x5EC0);
+}
+
+/**
+ * A write-back that fails: its owners keep the page, the faulting
+ * process is terminated.
+ */
+HIDDEN void testWriteError()
+{
+    pagerstat_t before;
+    unsigned int *p;
+    int i;
+
+    /* The parent's incompressible pages become dirty, so the next
+       eviction writes one of them to the flash */
+    for (i = 0; i < DATAPAGES; i += 2)
+        touch(1, i, TRUE)[0] = 1000 + i;
+    getStats(1, "dirty");
+    before = pgStats;
+
+    setupSpace(4, USERPGTBLSIZE - 1, FALSE);
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[4], (unsigned int)&sups[4], 0) == 0);
+    failWrites = 1;
+    for (i = 0; failWrites > 0 && i < USERPGTBLSIZE - 1; i++)
+    {
+        p = touch(4, i, TRUE);
+        if (p != NULL)
+            fillPage(p, i & ~1);
+    }
+    CHECK(failWrites == 0);
+    CHECK(!alive(4) && !pagerInUse(&sups[4]));
+    getStats(1, "werror");
+    CHECK(pgStats.pg_pageOuts > before.pg_pageOuts);
+    CHECK(pgStats.pg_maps > 0);
+    CHECK(pgStats.pg_blockRefs >= onFlash() && pgStats.pg_blocks <= pgStats.pg_blockRefs);
+
+    /* Nothing the others had was lost */
+    for (i = 0; i < DATAPAGES; i++)
+    {
+        p = touch(1, i, FALSE);
+        CHECK(isPage(p, i) && p[0] == 1000 + i);
+        p = touch(2, i, FALSE);
+        CHECK(isPage(p, i) && p[0] == (i == 0 ? 2000 : 1000 + i));
+    }
+    for (i = 0; i < TEXTPAGES; i++)
+        CHECK(isText(touch(3, TEXTIDX + i, FALSE), i));
+}
+
+/**
+ * Everybody terminates; nothing may be left.
+ */
+HIDDEN void testRelease()
+{
+    doSyscall(3, TERMINATEPROCESS, 0, 0, 0);
+    doSyscall(2, TERMINATEPROCESS, 0, 0, 0);
+    CHECK(!alive(2) && !alive(3));
+    CHECK(poolStats[POOLSHM].ps_inUse == 1);
+    doSyscall(1, TERMINATEPROCESS, 0, 0, 0);
+    CHECK(!alive(1));
+
+    getStats(ROOT, "released");
+    CHECK(pgStats.pg_frames == 0 && pgStats.pg_maps == 0);
+    CHECK(pgStats.pg_blocks == 0 && pgStats.pg_blockRefs == 0);
+    CHECK(poolStats[POOLPMAP].ps_inUse == 0);
+    CHECK(poolStats[POOLSHM].ps_inUse == 0);
+    CHECK(poolStats[POOLZPOOL].ps_inUse == 0);
+
+    /* The support structure can be used again */
+    setupSpace(1, 1, FALSE);
+    CHECK(doSyscall(ROOT, CREATEPROCESS, (unsigned int)&procStates[1], (unsigned int)&sups[1], 0) == 0);
+    CHECK(touch(1, 0, TRUE) != NULL);
+    doSyscall(1, TERMINATEPROCESS, 0, 0, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "-v") == 0)
+        verbose = 1;
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: vmtest [-v]\n");
+        return 2;
+    }
+
+    init();
+    testCreate();
+    testPaging();
+    testFork();
+    testBlockSharing();
+    testShm();
+    testWriteError();
+    testRelease();
+
+    printf("vmtest: %d checks, %d failed\n", checks, failures);
+    return failures != 0;
+}
@@ -0,0 +1,296 @@
+/************************** wfgraph.c ******************************
+ *
+ * Aggregates wakeup records of the nucleus' wait-for graph recorder
+ * (WAITGRAPH builds) into a weighted dependency graph.
+ *
+ * Input lines are "WAIT <waker> <wakee> <semaphore> <wait us>", as
+ * written by hostsim -w or printed by a test program that drains
+ * GETWAITGRAPH; all other lines are ignored, so a whole terminal capture
+ * can be fed in. Names are opaque tokens (pids, pcb addresses, "dev").
+ *
+ * Reported:
+ * - The edges waker -> wakee with wakeup count, total, mean and maximum
+ *   wait, heaviest first.
+ * - The critical path: the longest chain of waits in which every waker
+ *   was itself last woken by the previous link. Each record extends the
+ *   chain that ended at its waker's latest wakeup, so the path is found
+ *   in one pass over the records in time order.
+ *
+ * Usage: wfgraph [-n edges] [-d] [file ...]
+ *   -n   edges and path links to print (default 20)
+ *   -d   print the graph in Graphviz dot format instead
+ ***************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXNAME 64
+#define MAXLINE 256
+
+typedef struct edge_t
+{
+    int waker, wakee;
+    long count;
+    double total;
+    long max;
+    struct edge_t *next; /* hash chain */
+} edge_t;
+
+typedef struct record_t
+{
+    int waker, wakee, sem;
+    long wait;
+    long dep;     /* record that last woke the waker, -1 if none */
+    double chain; /* wait accumulated along the chain ending here */
+} record_t;
+
+/* Interned names: processes and semaphores share one table */
+static char (*names)[MAXNAME];
+static int nNames, maxNames;
+static int *nameHash;
+static int hashSize;
+
+static edge_t **edgeHash;
+static edge_t **edges;
+static int nEdges, maxEdges;
+
+static record_t *recs;
+static long nRecs, maxRecs;
+
+static long *lastWake; /* per name: latest record that woke it */
+
+static void *grow(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (p == NULL)
+    {
+        fprintf(stderr, "wfgraph: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static unsigned int hashString(const char *s)
+{
+    unsigned int h = 5381;
+
+    while (*s != '\0')
+        h = h * 33 + (unsigned char)*s++;
+    return h;
+}
+
+/**
+ * Returns the index of name, adding it the first time it is seen.
+ */
+static int intern(const char *name)
+{
+    unsigned int slot;
+    int i;
+
+    if (2 * (nNames + 1) > hashSize)
+    {
+        hashSize = hashSize ? 2 * hashSize : 1024;
+        nameHash = grow(nameHash, hashSize * sizeof(int));
+        for (i = 0; i < hashSize; i++)
+            nameHash[i] = -1;
+        for (i = 0; i < nNames; i++)
+        {
+            slot = hashString(names[i]) % hashSize;
+            while (nameHash[slot] >= 0)
+                slot = (slot + 1) % hashSize;
+            nameHash[slot] = i;
+        }
+    }
+
+    slot = hashString(name) % hashSize;
+    while (nameHash[slot] >= 0)
+    {
+        if (strcmp(names[nameHash[slot]], name) == 0)
+            return nameHash[slot];
+        slot = (slot + 1) % hashSize;
+    }
+
+    if (nNames == maxNames)
+    {
+        maxNames = maxNames ? 2 * maxNames : 256;
+        names = grow(names, maxNames * sizeof(*names));
+        lastWake = grow(lastWake, maxNames * sizeof(long));
+    }
+    strncpy(names[nNames], name, MAXNAME - 1);
+    names[nNames][MAXNAME - 1] = '\0';
+    lastWake[nNames] = -1;
+    nameHash[slot] = nNames;
+    return nNames++;
+}
+
+static void addEdge(int waker, int wakee, long wait)
+{
+    unsigned int slot = ((unsigned int)waker * 31 + (unsigned int)wakee) % 4096;
+    edge_t *e;
+
+    if (edgeHash == NULL)
+        edgeHash = calloc(4096, sizeof(edge_t *));
+
+    for (e = edgeHash[slot]; e != NULL; e = e->next)
+        if (e->waker == waker && e->wakee == wakee)
+            break;
+
+    if (e == NULL)
+    {
+        e = grow(NULL, sizeof(edge_t));
+        e->waker = waker;
+        e->wakee = wakee;
+        e->count = 0;
+        e->total = 0;
+        e->max = 0;
+        e->next = edgeHash[slot];
+        edgeHash[slot] = e;
+        if (nEdges == maxEdges)
+        {
+            maxEdges = maxEdges ? 2 * maxEdges : 256;
+            edges = grow(edges, maxEdges * sizeof(edge_t *));
+        }
+        edges[nEdges++] = e;
+    }
+
+    e->count++;
+    e->total += wait;
+    if (wait > e->max)
+        e->max = wait;
+}
+
+static void addRecord(const char *waker, const char *wakee, const char *sem, long wait)
+{
+    record_t *r;
+
+    if (nRecs == maxRecs)
+    {
+        maxRecs = maxRecs ? 2 * maxRecs : 4096;
+        recs = grow(recs, maxRecs * sizeof(record_t));
+    }
+    r = &recs[nRecs];
+    r->waker = intern(waker);
+    r->wakee = intern(wakee);
+    r->sem = intern(sem);
+    r->wait = wait;
+
+    /* Extend the chain that ended when the waker was last woken */
+    r->dep = lastWake[r->waker];
+    r->chain = wait + (r->dep >= 0 ? recs[r->dep].chain : 0);
+    lastWake[r->wakee] = nRecs;
+
+    addEdge(r->waker, r->wakee, wait);
+    nRecs++;
+}
+
+static void readInput(FILE *in)
+{
+    char line[MAXLINE], waker[MAXNAME], wakee[MAXNAME], sem[MAXNAME];
+    long wait;
+
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        if (sscanf(line, "WAIT %63s %63s %63s %ld", waker, wakee, sem, &wait) == 4)
+            addRecord(waker, wakee, sem, wait);
+    }
+}
+
+static int cmpEdge(const void *a, const void *b)
+{
+    double ta = (*(edge_t **)a)->total, tb = (*(edge_t **)b)->total;
+
+    return ta < tb ? 1 : ta > tb ? -1 : 0;
+}
+
+static void printDot()
+{
+    int i;
+
+    printf("digraph waitfor {\n");
+    for (i = 0; i < nEdges; i++)
+        printf("  \"%s\" -> \"%s\" [label=\"%ld / %.0f us\", weight=%ld];\n", names[edges[i]->waker],
+               names[edges[i]->wakee], edges[i]->count, edges[i]->total, edges[i]->count);
+    printf("}\n");
+}
+
+static void printReport(int top)
+{
+    long best = -1, r, *path;
+    int i, hops = 0;
+
+    printf("%ld wakeups, %d edges\n\n", nRecs, nEdges);
+    printf("%-16s %-16s %9s %14s %10s %10s\n", "waker", "wakee", "count", "total us", "mean", "max");
+    for (i = 0; i < nEdges && i < top; i++)
+        printf("%-16s %-16s %9ld %14.0f %10.0f %10ld\n", names[edges[i]->waker], names[edges[i]->wakee],
+               edges[i]->count, edges[i]->total, edges[i]->total / edges[i]->count, edges[i]->max);
+
+    for (r = 0; r < nRecs; r++)
+        if (best < 0 || recs[r].chain > recs[best].chain)
+            best = r;
+    if (best < 0)
+        return;
+
+    /* Walk the path back to its start, then print it in time order */
+    for (r = best; r >= 0; r = recs[r].dep)
+        hops++;
+    path = grow(NULL, hops * sizeof(long));
+    i = hops;
+    for (r = best; r >= 0; r = recs[r].dep)
+        path[--i] = r;
+
+    printf("\ncritical path: %d links, %.0f us of waiting\n", hops, recs[best].chain);
+    if (hops > top)
+        printf("  ... %d earlier links\n", hops - top);
+    for (i = hops > top ? hops - top : 0; i < hops; i++)
+    {
+        record_t *p = &recs[path[i]];
+        printf("  %-16s -> %-16s on %-16s %10ld us\n", names[p->waker], names[p->wakee], names[p->sem],
+               p->wait);
+    }
+    free(path);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: wfgraph [-n edges] [-d] [file ...]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int top = 20, dot = 0, files = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            top = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0)
+            dot = 1;
+        else if (argv[i][0] == '-')
+            usage();
+        else
+        {
+            FILE *in = fopen(argv[i], "r");
+            if (in == NULL)
+            {
+                perror(argv[i]);
+                exit(1);
+            }
+            readInput(in);
+            fclose(in);
+            files++;
+        }
+    }
+    if (files == 0)
+        readInput(stdin);
+
+    qsort(edges, nEdges, sizeof(edge_t *), cmpEdge);
+
+    if (dot)
+        printDot();
+    else
+        printReport(top);
+    return 0;
+}
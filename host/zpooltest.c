@@ -0,0 +1,274 @@
+/************************** zpooltest.c ******************************
+ *
+ * Host-side round-trip test of the compressor of the compressed swap
+ * pool (zpool.c).
+ *
+ * compress() and decompress() are private to zpool.c, so the file is
+ * included here; the rest of the nucleus objects are linked as for
+ * hostsim. Each page is compressed, checked against ZLIMIT, expanded
+ * and compared with the original, and its token stream is walked to
+ * check that every token is well formed. The cases:
+ * - zero-filled and repetitive pages, whose matches overlap their own
+ *   output, and literal runs of 128 and 129 bytes;
+ * - incompressible pages, which must be refused;
+ * - a page compressing to exactly ZLIMIT bytes, and the next larger
+ *   one, which must be refused;
+ * - a match reaching back across the whole page: the furthest offset a
+ *   page allows, PAGESIZE - ZMINMATCH, within the ZWINDOW of 4096;
+ * - pseudo-random pages over small alphabets, a mix of literals and
+ *   matches of every length;
+ * - storing pages under swap blocks until the pool is full, loading
+ *   them back and freeing them, with the POOLZPOOL chunks accounted.
+ *
+ * Usage: zpooltest
+ * Exits with 0 if every check passed, 1 otherwise.
+ ***************************************************************/
+
+#include "../phase2/zpool.c"
+
+#include <stdio.h>
+#include <string.h>
+#include "hostumps.h"
+
+#define FARPAGE   (PAGESIZE - ZMINMATCH) /* Furthest a match can reach in a page */
+#define MIXPAGES  500
+
+HIDDEN unsigned char page[PAGESIZE];
+HIDDEN unsigned char back[PAGESIZE];
+HIDDEN unsigned int seed;
+HIDDEN int checks = 0, failures = 0;
+
+/* Referenced by initial.c: the root process starts at test() */
+void test() {}
+
+#define CHECK(c) check((c), #c, __LINE__)
+
+HIDDEN void check(int ok, char *what, int line)
+{
+    checks++;
+    if (!ok)
+    {
+        failures++;
+        fprintf(stderr, "zpooltest:%d: check failed: %s (seed %u)\n", line, what, seed);
+    }
+}
+
+HIDDEN unsigned int nextRand()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+HIDDEN int far;     /* Longest match offset of the last page */
+HIDDEN int overlaps; /* Its matches shorter than their offset */
+
+/**
+ * Walks the len token bytes in zbuf, noting far and overlaps. Returns
+ * the page bytes they expand to, or -1 if a token runs past the end or
+ * a match reaches before the start of the page.
+ */
+HIDDEN int walkTokens(int len)
+{
+    int o = 0, out = 0, n, off;
+
+    far = 0;
+    overlaps = 0;
+    while (o < len)
+    {
+        n = zbuf[o++];
+        if (n < 0x80)
+        {
+            o += n + 1;
+            out += n + 1;
+            continue;
+        }
+        if (o + 2 > len)
+            return -1;
+        off = ((zbuf[o] << 8) | zbuf[o + 1]) + 1;
+        o += 2;
+        if (off > out || off > ZWINDOW)
+            return -1;
+        far = MAX(far, off);
+        n = n - 0x80 + ZMINMATCH;
+        if (off < n)
+            overlaps++;
+        out += n;
+    }
+    return o == len ? out : -1;
+}
+
+/**
+ * Compresses page and expands it again. Returns the compressed length,
+ * 0 if compress() refused the page; checks the round trip.
+ */
+HIDDEN int roundTrip()
+{
+    int len = compress(page);
+
+    far = 0;
+    overlaps = 0;
+    CHECK(len >= 0 && len <= ZLIMIT);
+    if (len == 0)
+        return 0;
+
+    CHECK(walkTokens(len) == PAGESIZE);
+    memset(back, 0xA5, PAGESIZE);
+    decompress(zbuf, len, back);
+    CHECK(memcmp(page, back, PAGESIZE) == 0);
+    return len;
+}
+
+/**
+ * Fills page[from..to) with bytes from an alphabet of n symbols.
+ */
+HIDDEN void randomBytes(int from, int to, int n)
+{
+    while (from < to)
+        page[from++] = nextRand() % n;
+}
+
+HIDDEN void testRepetitive()
+{
+    int len, i;
+
+    memset(page, 0, PAGESIZE);
+    len = roundTrip();
+    CHECK(len > 0 && len < 128);
+    /* Only match starts are hashed, so each match reaches back to the
+       last one: at most ZMAXMATCH back, and the first overlaps itself */
+    CHECK(far <= ZMAXMATCH && overlaps > 0);
+
+    for (i = 0; i < PAGESIZE; i++)
+        page[i] = "abc"[i % 3];
+    len = roundTrip();
+    CHECK(len > 0 && len < 256);
+    CHECK(overlaps > 0);
+
+    /* Literal runs of 128 and 129 bytes, then zeros */
+    for (i = ZMAXRUN; i <= ZMAXRUN + 1; i++)
+    {
+        seed = i;
+        memset(page, 0, PAGESIZE);
+        randomBytes(0, i, 256);
+        page[i] = 1; /* Keeps the tail from matching into the run */
+        CHECK(roundTrip() > i);
+    }
+}
+
+HIDDEN void testIncompressible()
+{
+    seed = 1;
+    randomBytes(0, PAGESIZE, 256);
+    CHECK(roundTrip() == 0);
+}
+
+HIDDEN void testLimit()
+{
+    int len = 0, n;
+
+    /* n random bytes, then zeros: the length grows about one byte per n */
+    for (n = PAGESIZE / 2; n < PAGESIZE; n++)
+    {
+        seed = 7;
+        memset(page, 0, PAGESIZE);
+        randomBytes(0, n, 256);
+        len = roundTrip();
+        if (len == 0 || len == ZLIMIT)
+            break;
+    }
+    CHECK(len == ZLIMIT);
+
+    seed = 7;
+    memset(page, 0, PAGESIZE);
+    randomBytes(0, n + 1, 256);
+    CHECK(roundTrip() == 0);
+}
+
+HIDDEN void testFarMatch()
+{
+    seed = 3;
+    memset(page, 0, PAGESIZE);
+    page[0] = 'X';
+    page[1] = 'Y';
+    page[2] = 'Z';
+    page[FARPAGE] = 'X';
+    page[FARPAGE + 1] = 'Y';
+    page[FARPAGE + 2] = 'Z';
+    CHECK(roundTrip() > 0);
+    CHECK(far == FARPAGE);
+}
+
+HIDDEN void testMixed()
+{
+    int n, i, stored = 0;
+
+    for (n = 0; n < MIXPAGES; n++)
+    {
+        seed = 1000 + n;
+        randomBytes(0, PAGESIZE, 2 + n % 7);
+        /* Runs of one byte, so matches of every length show up */
+        for (i = nextRand() % PAGESIZE; i < PAGESIZE; i += 1 + nextRand() % 512)
+            memset(page + i, page[i], MIN(nextRand() % 300, PAGESIZE - i));
+        if (roundTrip() > 0)
+            stored++;
+    }
+    CHECK(stored > MIXPAGES / 2);
+}
+
+/**
+ * Stores pages until the pool is full, then loads and frees them.
+ */
+HIDDEN void testPool()
+{
+    poolstat_t *ps = &poolStats[POOLZPOOL];
+    int blk, n, i, used, chunks = 0;
+
+    initPages();
+    initZpool();
+    CHECK(zpool != NULL && ps->ps_size == ZCHUNKS && ps->ps_inUse == 0);
+
+    for (blk = 0; blk < MAXSWAPBLOCKS; blk++)
+    {
+        seed = blk;
+        memset(page, 0, PAGESIZE);
+        randomBytes(0, PAGESIZE / 2, 256);
+        n = (compress(page) + ZCHUNKSIZE - 1) / ZCHUNKSIZE;
+        if (!zpoolStore(blk, (memaddr)page))
+            break;
+        chunks += n;
+    }
+    n = blk;
+    CHECK(n > 0 && n < MAXSWAPBLOCKS);
+    CHECK(ps->ps_failures == 1);
+    CHECK(ps->ps_inUse == chunks);
+
+    for (blk = n - 1; blk >= 0; blk--)
+    {
+        seed = blk;
+        memset(page, 0, PAGESIZE);
+        randomBytes(0, PAGESIZE / 2, 256);
+        memset(back, 0xA5, PAGESIZE);
+        CHECK(zpoolLoad(blk, (memaddr)back));
+        CHECK(memcmp(page, back, PAGESIZE) == 0);
+        zpoolFree(blk);
+        CHECK(!zpoolLoad(blk, (memaddr)back));
+    }
+    CHECK(ps->ps_inUse == 0);
+    for (i = used = 0; i < ZCHUNKS; i++)
+        used += zused[i];
+    CHECK(used == 0);
+}
+
+int main()
+{
+    hostInit();
+    testRepetitive();
+    testIncompressible();
+    testLimit();
+    testFarMatch();
+    testMixed();
+    testPool();
+
+    printf("zpooltest: %d checks, %d failed\n", checks, failures);
+    return failures != 0;
+}
@@ -0,0 +1,188 @@
+/************************** acct.c ******************************
+ *
+ * Process accounting: one compact record per terminated process.
+ *
+ * sysTerminate() calls acctRecord() for every process it removes
+ * (the explicit target and each descendant). A record holds the pid,
+ * the parent's pid, the lifetime, the CPU time and the time blocked
+ * on devices, on the pseudo-clock and on ordinary semaphores, the
+ * number of dispatches, SYSCALLs and SYS5 calls, and why the process
+ * ended (EXITNORMAL ... EXITFAULT).
+ *
+ * Records wait in acctRing; when it is full the oldest is dropped and
+ * counted in acctLost. Every ACCTFLUSHTICKS Interval Timer ticks
+ * acctTick() copies up to one flash block of records into acctBlock
+ * and starts an asynchronous WRITEBLK on flash ACCTFLASHDEV, filling the
+ * device's blocks round robin. The completion interrupt is consumed by
+ * acctInterrupt() rather than V'ing the device semaphore, so that flash
+ * device must not be used by processes. Unused record slots of a block
+ * are zero (pid 0). If the device is not installed nothing is written.
+ *
+ * acctSync() writes everything still pending by polling the device;
+ * the nucleus calls it right before HALT.
+ ***************************************************************/
+
+#include "../h/acct.h"
+#include "../h/initial.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+#define ACCTPERBLOCK (PAGESIZE / sizeof(acctrec_t)) /* Records per flash block */
+
+/* Records of terminated processes not yet written */
+static acctrec_t acctRing[ACCTRINGSIZE];
+static int acctHead = 0;
+static int acctCount = 0;
+
+/* DMA buffer of the write in progress and its record count */
+static acctrec_t acctBlock[ACCTPERBLOCK];
+static int acctInFlight = 0;
+
+static unsigned int acctNextBlock = 0; /* Next flash block to write */
+static int acctTicks = 0;              /* Ticks since the last write */
+
+unsigned int acctLost = 0;    /* Records dropped (ring full, failed write) */
+unsigned int acctWritten = 0; /* Records written to flash */
+
+/**
+ * Appends the accounting record of p, which is being terminated
+ * for the given reason.
+ */
+void acctRecord(pcb_t *p, int reason)
+{
+    acctrec_t *rec;
+    cpu_t currentTOD;
+    int i;
+
+    if (acctCount == ACCTRINGSIZE)
+    {
+        acctHead = (acctHead + 1) % ACCTRINGSIZE; /* Drop the oldest */
+        acctCount--;
+        acctLost++;
+        poolFailed(POOLACCT);
+        poolPut(POOLACCT);
+    }
+
+    STCK(currentTOD);
+    rec = &acctRing[(acctHead + acctCount) % ACCTRINGSIZE];
+    rec->ar_pid = p->p_pid;
+    rec->ar_parent = (p->p_prnt != NULL) ? p->p_prnt->p_pid : 0;
+    rec->ar_lifetime = currentTOD - p->p_createTOD;
+    rec->ar_cpuTime = p->p_time;
+    if (p == currentProcess)
+    {
+        rec->ar_cpuTime += currentTOD - p->p_startTOD; /* Current slice */
+    }
+    rec->ar_ioTime = p->p_ioTime;
+    rec->ar_clockTime = p->p_clockTime;
+    rec->ar_semTime = p->p_semTime;
+    rec->ar_switches = p->p_switches;
+    rec->ar_syscalls = p->p_syscalls;
+    rec->ar_ioCount = 0;
+    for (i = 0; i < DEVINTNUM; i++)
+    {
+        rec->ar_ioCount += p->p_ioCount[i];
+    }
+    rec->ar_exitReason = reason;
+    acctCount++;
+    poolGet(POOLACCT);
+}
+
+/**
+ * Moves up to one block of records into acctBlock and starts writing
+ * it. Returns FALSE if there was nothing to write or no device.
+ */
+static int startWrite()
+{
+    device_t *flash = DEV_REG_ADDR(FLASHINT, ACCTFLASHDEV);
+    unsigned int blocks = flash->d_data1; /* Flash DATA1: number of blocks */
+    char *b;
+    int i;
+
+    if (acctCount == 0 || flash->d_status == UNINSTALLED || blocks == 0)
+        return FALSE;
+
+    acctInFlight = MIN(acctCount, (int)ACCTPERBLOCK);
+    for (i = 0; i < acctInFlight; i++)
+    {
+        acctBlock[i] = acctRing[acctHead];
+        acctHead = (acctHead + 1) % ACCTRINGSIZE;
+        poolPut(POOLACCT);
+    }
+    acctCount -= acctInFlight;
+
+    b = (char *)&acctBlock[acctInFlight];
+    while (b < (char *)&acctBlock[ACCTPERBLOCK])
+    {
+        *b++ = 0; /* Empty slots */
+    }
+
+    flash->d_data0 = (memaddr)acctBlock;
+    flash->d_command = (acctNextBlock % blocks) << 8 | FLASHWRITEBLK;
+    acctNextBlock = (acctNextBlock + 1) % blocks;
+    return TRUE;
+}
+
+/**
+ * Settles a finished write with the device status it returned.
+ */
+static void writeDone(unsigned int status)
+{
+    if ((status & 0xFF) == READY)
+    {
+        acctWritten += acctInFlight;
+    }
+    else
+    {
+        acctLost += acctInFlight;
+    }
+    acctInFlight = 0;
+}
+
+/**
+ * Called on every Interval Timer tick: starts a write every
+ * ACCTFLUSHTICKS ticks unless one is still in progress.
+ */
+void acctTick()
+{
+    if (++acctTicks < ACCTFLUSHTICKS || acctInFlight > 0)
+        return;
+
+    acctTicks = 0;
+    startWrite();
+}
+
+/**
+ * Called for an (already ACKed) interrupt of flash devNum. Returns TRUE
+ * if it completed an accounting write, FALSE if it belongs to someone else.
+ */
+int acctInterrupt(int devNum, unsigned int status)
+{
+    if (devNum != ACCTFLASHDEV || acctInFlight == 0)
+        return FALSE;
+
+    writeDone(status);
+    return TRUE;
+}
+
+/**
+ * Writes every pending record synchronously, polling the device.
+ * Interrupts are off in the nucleus, so this is only used at shutdown.
+ */
+void acctSync()
+{
+    volatile device_t *flash = DEV_REG_ADDR(FLASHINT, ACCTFLASHDEV); /* Polled */
+
+    do
+    {
+        if (acctInFlight > 0)
+        {
+            while ((flash->d_status & 0xFF) == BUSY)
+                ;
+            writeDone(flash->d_status);
+            flash->d_command = ACK;
+        }
+    } while (startWrite());
+}
@@ -4,59 +4,69 @@
  * The ASL is used to track active semaphores and their associated process queues.
  *
  * Data Structure Overview:
- * - semd_t semdTable[MAXSEMD + 2]: A static array of semaphore descriptors.
- *   The first and last elements serve as dummy head and tail nodes for efficient list traversal.
+ * - semdCache: Slab cache of at most MAXSEMD semaphore descriptors. Its constructor
+ *   empties the process queue, and descriptors are only freed with an empty queue.
+ * - semdHead, semdTail: Dummy head and tail nodes for efficient list traversal.
  * - semd_h: Pointer to the head of the ASL, initialized with the dummy head node.
- * - semdFree_h: Pointer to the head of the free semaphore descriptor list.
+ * - semStats[SEMSTATSIZE]: Contention records, an open-addressing hash table keyed
+ *   by semaphore address. A record outlives the semaphore's descriptor, so counts
+ *   accumulate over the whole run; once the table is full new semaphores are not tracked.
+ * - Descriptor and contention record usage is reported in poolStats[] (POOLSEMD, POOLSEMSTAT).
  *
  * Implementation Summary:
  * - The ASL is maintained as a sorted singly linked list using semaphore addresses (s_semAdd) for ordering.
- * - Semaphore descriptors are allocated from semdFree_h and returned to it when no longer needed.
+ * - Semaphore descriptors are allocated from semdCache and returned to it when no longer needed.
  * - Functions are provided for inserting, removing, and querying process control blocks (pcbs) associated with semaphores.
+ * - insertBlocked() stamps the pcb with the blocking TOD; removeBlocked() and outBlocked()
+ *   charge the elapsed time to the semaphore's record.
 ***************************************************************/
 
 #include "../h/asl.h"
 #include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/slab.h"
 #include "../h/const.h"
 
 #define MAXSEMD MAXPROC /* MAXSEMD is set to MAXPROC */
 
-/* Static array of semaphore descriptors (+2 for dummy head/tail) */
-static semd_t semdTable[MAXSEMD + 2];
+/* Semaphore descriptor storage */
+static kcache_t semdCache;
+
+/* Dummy head and tail nodes */
+static semd_t semdHead, semdTail;
 
 /* Head of Active Semaphore List (ASL) */
 static semd_t *semd_h;
 
-/* Head of Free Semaphore List */
-static semd_t *semdFree_h;
+/* Per-semaphore contention records */
+static semstat_t semStats[SEMSTATSIZE];
+
+/**
+ * semdCache constructor: a free descriptor has an empty process queue.
+ */
+static void constructSemd(void *obj)
+{
+    ((semd_t *)obj)->s_procQ = mkEmptyProcQ();
+}
 
 /**
- * Initializes semdFree_h with semdTable[MAXSEMD] and sets up semd_h
- * with dummy head and tail nodes for efficient ASL traversal.
- * Called once during system initialization.
+ * Sets up semdCache and semd_h with dummy head and tail nodes for
+ * efficient ASL traversal.
+ * Called once during system initialization, after initPages().
  */
 void initASL()
 {
     /* Initialize dummy head and tail nodes */
-    semd_h = &semdTable[0];      /* Head dummy node */
+    semd_h = &semdHead;          /* Head dummy node */
     semd_h->s_semAdd = (int *)0; /* Set head sentinel value */
 
-    semd_t *tail = &semdTable[MAXSEMD + 1]; /* Tail dummy node */
-    tail->s_semAdd = (int *)MAXINT;         /* Set tail sentinel value */
+    semd_t *tail = &semdTail;       /* Tail dummy node */
+    tail->s_semAdd = (int *)MAXINT; /* Set tail sentinel value */
 
     semd_h->s_next = tail; /* Link head to tail */
     tail->s_next = NULL;   /* Tail points to NULL */
 
-    /* Initialize the Free List */
-    semdFree_h = &semdTable[1]; /* First free semaphore */
-
-    int i;
-    for (i = 1; i < MAXSEMD; i++)
-    {
-        semdTable[i].s_next = &semdTable[i + 1]; /* Link free list elements */
-    }
-
-    semdTable[MAXSEMD].s_next = NULL; /* Last free element points to NULL */
+    kcacheInit(&semdCache, "semd", sizeof(semd_t), constructSemd, MAXSEMD, POOLSEMD);
 }
 
 /**
@@ -81,11 +91,108 @@ static semd_t *findSemd(int *semAdd)
     return NULL;
 }
 
+/**
+ * Returns the contention record of semAdd, claiming a free slot the
+ * first time the semaphore is seen. Returns NULL if the table is full.
+ */
+static semstat_t *findSemStat(int *semAdd)
+{
+    unsigned int slot = ((unsigned int)semAdd >> 2) % SEMSTATSIZE;
+    int probes;
+
+    for (probes = 0; probes < SEMSTATSIZE; probes++)
+    {
+        semstat_t *stat = &semStats[slot];
+
+        if (stat->ss_semAdd == semAdd)
+            return stat;
+
+        if (stat->ss_semAdd == (int *)0)
+        {
+            stat->ss_semAdd = semAdd; /* Claim the empty slot */
+            poolGet(POOLSEMSTAT);
+            return stat;
+        }
+
+        slot = (slot + 1) % SEMSTATSIZE;
+    }
+
+    poolFailed(POOLSEMSTAT);
+    return NULL;
+}
+
+/**
+ * Charges the time p spent blocked to the record of its semaphore.
+ * Called whenever p leaves a semaphore queue.
+ */
+static void countUnblock(int *semAdd, pcb_t *p)
+{
+    semstat_t *stat = findSemStat(semAdd);
+    cpu_t now;
+
+    if (stat == NULL)
+        return;
+
+    STCK(now);
+    if (stat->ss_queueLen > 0)
+        stat->ss_queueLen--;
+    stat->ss_waitTotal += now - p->p_blockTOD;
+    stat->ss_waitMax = MAX(stat->ss_waitMax, now - p->p_blockTOD);
+}
+
+/**
+ * Counts a P operation on semAdd; called by SYS3 and the P done by
+ * SYS5/SYS7, whether or not the caller ends up blocked.
+ */
+void countPasseren(int *semAdd)
+{
+    semstat_t *stat = findSemStat(semAdd);
+
+    if (stat != NULL)
+        stat->ss_pCount++;
+}
+
+/**
+ * Copies the records of the (at most) n semaphores with the largest
+ * total wait time into buf, most contended first. Semaphores that never
+ * blocked anyone are skipped. Returns the number of records copied.
+ */
+int getSemStats(semstat_t *buf, int n)
+{
+    int count = 0;
+    int i, j;
+
+    for (i = 0; i < SEMSTATSIZE; i++)
+    {
+        semstat_t *stat = &semStats[i];
+
+        if (stat->ss_semAdd == (int *)0 || stat->ss_blockCount == 0)
+            continue;
+
+        /* Insertion into the sorted output, dropping the least contended */
+        j = MIN(count, n - 1);
+        if (j < 0 || (count == n && buf[j].ss_waitTotal >= stat->ss_waitTotal))
+            continue;
+
+        while (j > 0 && buf[j - 1].ss_waitTotal < stat->ss_waitTotal)
+        {
+            buf[j] = buf[j - 1];
+            j--;
+        }
+        buf[j] = *stat;
+
+        if (count < n)
+            count++;
+    }
+
+    return count;
+}
+
 /**
  * Inserts the pcb p at the tail of the process queue associated with
  * the semaphore at semAdd. If the semaphore is inactive, allocates a
- * new descriptor from semdFree_h and inserts it into the ASL in sorted order.
- * Returns TRUE if a new descriptor is needed but semdFree_h is empty,
+ * new descriptor from semdCache and inserts it into the ASL in sorted order.
+ * Returns TRUE if a new descriptor is needed but semdCache has none,
  * otherwise returns FALSE.
  */
 int insertBlocked(int *semAdd, pcb_t *p)
@@ -97,16 +204,13 @@ int insertBlocked(int *semAdd, pcb_t *p)
 
     if (semd == NULL)
     {
-        /* Allocate new semd_t from the free list */
-        if (semdFree_h == NULL)
+        /* Allocate new semd_t, its process queue already empty */
+        semd = kcacheAlloc(&semdCache);
+        if (semd == NULL)
             return TRUE; /* No free descriptors available */
 
-        semd = semdFree_h;               /* Take first free descriptor */
-        semdFree_h = semdFree_h->s_next; /* Update free list */
-
         /* Initialize new semaphore descriptor */
         semd->s_semAdd = semAdd;
-        semd->s_procQ = mkEmptyProcQ();
 
         /* Insert into ASL in sorted order */
         semd_t *prev = semd_h;
@@ -124,6 +228,16 @@ int insertBlocked(int *semAdd, pcb_t *p)
     /* Set semaphore address in the process */
     p->p_semAdd = semAdd;
 
+    /* Contention profile: one more waiter, blocked from now */
+    STCK(p->p_blockTOD);
+    semstat_t *stat = findSemStat(semAdd);
+    if (stat != NULL)
+    {
+        stat->ss_blockCount++;
+        stat->ss_queueLen++;
+        stat->ss_maxQueueLen = MAX(stat->ss_maxQueueLen, stat->ss_queueLen);
+    }
+
     return FALSE;
 }
 
@@ -131,7 +245,7 @@ int insertBlocked(int *semAdd, pcb_t *p)
  * Removes and returns the first pcb from the process queue of the
  * semaphore at semAdd. If the semaphore is not found, returns NULL.
  * If the process queue becomes empty, removes the semaphore descriptor
- * from the ASL and returns it to semdFree_h.
+ * from the ASL and returns it to semdCache.
  */
 pcb_t *removeBlocked(int *semAdd)
 {
@@ -148,6 +262,8 @@ pcb_t *removeBlocked(int *semAdd)
     /* Clear pcb's semaphore reference */
     removedPcb->p_semAdd = NULL;
 
+    countUnblock(semAdd, removedPcb);
+
     /* If the process queue is now empty, remove the semaphore descriptor from ASL */
     if (emptyProcQ(semd->s_procQ))
     {
@@ -162,9 +278,8 @@ pcb_t *removeBlocked(int *semAdd)
             prev->s_next = semd->s_next; /* Unlink semd from ASL */
         }
 
-        /* Return the semaphore descriptor to the free list */
-        semd->s_next = semdFree_h;
-        semdFree_h = semd;
+        /* Return the semaphore descriptor to the cache */
+        kcacheFree(&semdCache, semd);
     }
 
     return removedPcb;
@@ -174,7 +289,7 @@ pcb_t *removeBlocked(int *semAdd)
  * Removes the pcb p from the process queue associated with
  * its semaphore (p->p_semAdd). If p is not found in the
  * queue, returns NULL. If the queue becomes empty, removes the
- * semaphore descriptor from the ASL and returns it to semdFree_h.
+ * semaphore descriptor from the ASL and returns it to semdCache.
  * Unlike removeBlocked(), this function does NOT reset p->p_semAdd to NULL.
  */
 pcb_t *outBlocked(pcb_t *p)
@@ -192,6 +307,8 @@ pcb_t *outBlocked(pcb_t *p)
     if (removedPcb == NULL)
         return NULL; /* p was NOT in the process queue (error condition) */
 
+    countUnblock(p->p_semAdd, p);
+
     /* If the process queue is now empty, remove the semaphore descriptor from ASL */
     if (emptyProcQ(semd->s_procQ))
     {
@@ -205,9 +322,8 @@ pcb_t *outBlocked(pcb_t *p)
             prev->s_next = semd->s_next; /* Unlink semd from ASL */
         }
 
-        /* Return the semaphore descriptor to the free list */
-        semd->s_next = semdFree_h;
-        semdFree_h = semd;
+        /* Return the semaphore descriptor to the cache */
+        kcacheFree(&semdCache, semd);
     }
 
     return p;
@@ -13,10 +13,21 @@
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
 #include "../h/pcb.h"
+#include "../h/pool.h"
 #include "../h/asl.h"
 #include "../h/types.h"
 #include "../h/scheduler.h"
 #include "../h/initial.h"
+#include "../h/waitgraph.h"
+#include "../h/stats.h"
+#include "../h/acct.h"
+#include "../h/kpage.h"
+#include "../h/prof.h"
+#include "../h/klog.h"
+#include "../h/pager.h"
+#include "../h/palloc.h"
+#include "../h/tlb.h"
+#include "../h/shm.h"
 #include "../h/const.h"
 
 /**
@@ -72,11 +83,24 @@ void exceptionHandler()
 
     default:
         /* Undefined exception, terminate the process */
-        sysTerminate(currentProcess);
+        sysTerminate(currentProcess, EXITFAULT);
         scheduler();
     }
 }
 
+/**
+ * Reads a support structure argument. Callers pass 0 as well as NULL for
+ * "no support structure" (p2test does), and the two must mean the same:
+ * a support_t at address 0 would be paged, pinned and released by the
+ * pager and the shm services like a real one.
+ */
+static support_t *supportArg(unsigned int a)
+{
+    if (a == 0)
+        return NULL;
+    return (support_t *)(memaddr)a;
+}
+
 /**
  * Determines the system call type based on the function number stored in
  * register a0 of the saved state. If a syscall is invoked from user mode,
@@ -98,15 +122,18 @@ void syscallHandler(state_t *savedState)
     /* Retrieve syscall number from register a0 */
     int syscallNumber = savedState->s_a0;
 
+    currentProcess->p_syscalls++;
+
     switch (syscallNumber)
     {
     case CREATEPROCESS:
-        /* Process creation */
-        savedState->s_v0 = sysCreateProcess((state_t *)savedState->s_a1, (support_t *)savedState->s_a2);
+        /* Process creation; a3 is the size of a stack to allocate, 0 for none */
+        savedState->s_v0 = sysCreateProcess((state_t *)savedState->s_a1, supportArg(savedState->s_a2),
+                                            (unsigned int)savedState->s_a3);
         break;
     case TERMINATEPROCESS:
         /* debugVar2 = 0xBEEF; */
-        sysTerminate(currentProcess);
+        sysTerminate(currentProcess, EXITNORMAL);
         scheduler();
         break;
     case PASSEREN:
@@ -133,28 +160,172 @@ void syscallHandler(state_t *savedState)
         /* Return the process's support structure */
         savedState->s_v0 = (int)sysGetSupportPTR();
         break;
+    case GETSEMSTATS:
+        /* Copy out the most contended semaphores */
+        savedState->s_v0 = getSemStats((semstat_t *)savedState->s_a1, savedState->s_a2);
+        break;
+    case GETWAITGRAPH:
+        /* Drain the wait-for graph recorder */
+        savedState->s_v0 = getWaitRecords((waitrec_t *)savedState->s_a1, savedState->s_a2);
+        break;
+    case GETLOADAVG:
+        /* Return the system load statistics */
+        getLoadStats((loadstat_t *)savedState->s_a1);
+        savedState->s_v0 = 0;
+        break;
+    case GETACCOUNTING:
+        /* Return the caller's CPU and blocking accounting */
+        sysGetAccounting(savedState);
+        break;
+    case GETPOOLSTATS:
+        /* Copy out the kernel pool usage */
+        memcopy((poolstat_t *)savedState->s_a1, poolStats, sizeof(poolStats));
+        savedState->s_v0 = NUMPOOLS;
+        break;
+    case GETKPAGE:
+        /* Address of the shared kernel data page */
+        savedState->s_v0 = (int)&kernelPage;
+        break;
+    case GETPROFILE:
+        /* Copy out the function profile of a PROFILE build */
+        savedState->s_v0 = getProfile((profrec_t *)savedState->s_a1, savedState->s_a2);
+        break;
+    case GETPAGERSTATS:
+        /* Copy out the pager statistics */
+        getPagerStats((pagerstat_t *)savedState->s_a1);
+        savedState->s_v0 = 0;
+        break;
+    case GETPAGESTATS:
+        /* Copy out the page allocator statistics */
+        getPageStats((pagestat_t *)savedState->s_a1);
+        savedState->s_v0 = 0;
+        break;
+    case DUMPPROFILE:
+        /* Print the function profile on the kernel log terminal */
+        dumpProfile();
+        break;
+    case FORKPROCESS:
+        /* SYS1 in a copy-on-write copy of the caller's address space */
+        savedState->s_v0 = sysForkProcess((state_t *)savedState->s_a1, supportArg(savedState->s_a2));
+        break;
+    case SHMCREATE:
+        /* Shared segments, in the caller's address space */
+        savedState->s_v0 = shmCreate(currentProcess->p_supportStruct, (unsigned int)savedState->s_a1,
+                                     (memaddr)savedState->s_a2);
+        break;
+    case SHMMAP:
+        savedState->s_v0 = shmMap(currentProcess->p_supportStruct, savedState->s_a1, (memaddr)savedState->s_a2);
+        break;
+    case SHMUNMAP:
+        savedState->s_v0 = shmUnmap(currentProcess->p_supportStruct, (memaddr)savedState->s_a1);
+        break;
     default:
         /* Invalid syscall, terminate the process */
-        sysTerminate(currentProcess);
+        sysTerminate(currentProcess, EXITBADSYSCALL);
         scheduler();
     }
 
     LDST(savedState);
 }
 
+/**
+ * Gives p a stack of at least size bytes from the page allocator and
+ * points its s_sp at the top. A process running in kuseg with a support
+ * structure (VM) gets a single page, mapped as its stack page
+ * USERSTACKVPN: the page below it has no page table entry, so it is a
+ * guard page and an overflow faults instead of running into other
+ * memory. Returns FALSE if the stack cannot be had.
+ */
+static int allocStack(pcb_t *p, unsigned int size)
+{
+    support_t *sup = p->p_supportStruct;
+    int vm = sup != NULL && (unsigned int)p->p_s.s_pc >= KUSEG;
+    int order = pagesOrder(size);
+    pteEntry_t *pte;
+
+    if (order >= PAGEORDERS || (vm && order > 0))
+        return FALSE; /* Larger than any block, or than the stack page */
+
+    p->p_stack = allocPages(order);
+    if (p->p_stack == NULL)
+        return FALSE;
+
+    if (vm)
+    {
+        pte = &sup->sup_privatePgTbl[USERPGTBLSIZE - 1];
+        pte->pte_entryHI = USERSTACKVPN | ((sup->sup_asid & (MAXASID - 1)) << ASIDSHIFT);
+        pte->pte_entryLO = (memaddr)p->p_stack | VALIDON | DIRTYON;
+        tlbSyncPte(sup, USERPGTBLSIZE - 1);
+        p->p_s.s_sp = USERSTACKVPN + PAGESIZE;
+    }
+    else
+    {
+        p->p_s.s_sp = (memaddr)p->p_stack + (PAGESIZE << order);
+    }
+    return TRUE;
+}
+
+/**
+ * Frees the stack allocStack() gave p, unmapping it first if it is the
+ * stack page of p's address space.
+ */
+static void freeStack(pcb_t *p)
+{
+    support_t *sup = p->p_supportStruct;
+    pteEntry_t *pte;
+
+    if (sup != NULL)
+    {
+        pte = &sup->sup_privatePgTbl[USERPGTBLSIZE - 1];
+        if ((pte->pte_entryLO & PFNMASK) == (memaddr)p->p_stack)
+        {
+            pte->pte_entryLO = 0;
+            tlbSyncPte(sup, USERPGTBLSIZE - 1);
+        }
+    }
+    freePages(p->p_stack);
+    p->p_stack = NULL;
+}
+
+/**
+ * Makes newProcess, set up by SYS1 or FORKPROCESS, a child of the
+ * current process and puts it on the Ready Queue.
+ */
+static void startProcess(pcb_t *newProcess)
+{
+    /* Initialize other process fields */
+    newProcess->p_time = 0;      /* Reset CPU time */
+    newProcess->p_semAdd = NULL; /* Not blocked on any semaphore */
+
+    /* Make it a child of the current process */
+    insertChild(currentProcess, newProcess);
+
+    /* Insert into Ready Queue */
+    insertProcQ(&readyQueue, newProcess);
+
+    processCount++;
+    KDEBUG(("pid %u created by pid %u", newProcess->p_pid, currentProcess->p_pid));
+}
+
 /**
  * Creates a new process with the provided processor state.
  * Allocates a new PCB, initializes its state, and sets its parent-child
- * relationship. The new process is then inserted into the Ready Queue
+ * relationship. If stackSize is not 0, the process also gets a stack of
+ * that many bytes (see allocStack) and statep's s_sp is ignored. The
+ * paged entries of supportp's page table are handed to the pager (see
+ * pagerAttach), and its shared segment pages counted (see shmHold); it
+ * must not be the support structure of a live process.
+ * The new process is then inserted into the Ready Queue
  * to be scheduled for execution.
  * Returns 0 on success, -1 if process creation fails (e.g., no available pcbs).
  */
-int sysCreateProcess(state_t *statep, support_t *supportp)
+int sysCreateProcess(state_t *statep, support_t *supportp, unsigned int stackSize)
 {
     /* Allocate a new PCB */
     pcb_t *newProcess = allocPcb();
     if (newProcess == NULL)
     {
+        KINFO(("SYS1 by pid %u: out of pcbs", currentProcess->p_pid));
         return -1; /* No more free pcbs, return error */
     }
 
@@ -162,46 +333,170 @@ int sysCreateProcess(state_t *statep, support_t *supportp)
     memcopy(&(newProcess->p_s), statep, sizeof(state_t));
     newProcess->p_supportStruct = supportp; /* Set support structure (NULL if not provided) */
 
-    /* Initialize other process fields */
-    newProcess->p_time = 0;      /* Reset CPU time */
-    newProcess->p_semAdd = NULL; /* Not blocked on any semaphore */
-
-    /* Make it a child of the current process */
-    insertChild(currentProcess, newProcess);
+    /* One process per address space; checked before allocStack() maps
+       the stack into the page table of the owner */
+    if (supportp != NULL && pagerInUse(supportp))
+    {
+        KINFO(("SYS1 by pid %u: support structure in use", currentProcess->p_pid));
+        freePcb(newProcess);
+        return -1;
+    }
 
-    /* Insert into Ready Queue */
-    insertProcQ(&readyQueue, newProcess);
+    /* Kernel-provided stack */
+    if (stackSize != 0 && !allocStack(newProcess, stackSize))
+    {
+        KINFO(("SYS1 by pid %u: no %u byte stack", currentProcess->p_pid, stackSize));
+        freePcb(newProcess);
+        return -1;
+    }
 
-    processCount++;
+    /* Paged entries must name blocks of the swap flash, shared ones segments */
+    if (supportp != NULL && !shmHold(supportp))
+    {
+        KINFO(("SYS1 by pid %u: bad shared page in page table", currentProcess->p_pid));
+        if (newProcess->p_stack != NULL)
+            freeStack(newProcess);
+        freePcb(newProcess);
+        return -1;
+    }
+    if (supportp != NULL && !pagerAttach(supportp))
+    {
+        KINFO(("SYS1 by pid %u: bad swap block in page table", currentProcess->p_pid));
+        shmRelease(supportp);
+        if (newProcess->p_stack != NULL)
+            freeStack(newProcess);
+        freePcb(newProcess);
+        return -1;
+    }
 
+    startProcess(newProcess);
     return 0; /* Success */
 }
 
+/**
+ * Returns TRUE if the page table of p maps a writable page that is
+ * neither paged, of a shared segment, nor p's SYS1 stack: such a page
+ * belongs to the support level, so FORKPROCESS can neither share nor
+ * copy it.
+ */
+static int plainWritable(pcb_t *p)
+{
+    pteEntry_t *pte;
+    int i;
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        pte = &p->p_supportStruct->sup_privatePgTbl[i];
+        if ((pte->pte_entryLO & (VALIDON | DIRTYON)) != (VALIDON | DIRTYON) || (pte->pte_entryLO & (PTEPAGED | PTESHM)))
+            continue;
+        if (p->p_stack == NULL || (pte->pte_entryLO & PFNMASK) != (memaddr)p->p_stack)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * FORKPROCESS: creates a child of the current process, which must have
+ * a support structure, running from statep in a copy of the current
+ * address space. supportp is the child's support structure, which no
+ * live process (the caller included) may be using; its page table is
+ * overwritten (tagged with its ASID) and its exception contexts are the
+ * caller's to set. Paged pages are shared copy on write (see pagerFork)
+ * and shared segments stay shared; the stack page SYS1 gave the caller,
+ * if it is mapped, is copied at once.
+ * Returns 0 on success, -1 if supportp is in use, the caller has a
+ * writable page of its own that is not paged (see plainWritable), or
+ * there is no pcb, mapping record or page.
+ */
+int sysForkProcess(state_t *statep, support_t *supportp)
+{
+    support_t *parent = currentProcess->p_supportStruct;
+    pcb_t *newProcess;
+    pteEntry_t *pte;
+
+    if (parent == NULL || supportp == NULL || pagerInUse(supportp))
+        return -1;
+    if (plainWritable(currentProcess))
+    {
+        KINFO(("FORKPROCESS by pid %u: writable page not paged", currentProcess->p_pid));
+        return -1;
+    }
+
+    newProcess = allocPcb();
+    if (newProcess == NULL)
+    {
+        KINFO(("FORKPROCESS by pid %u: out of pcbs", currentProcess->p_pid));
+        return -1;
+    }
+    memcopy(&(newProcess->p_s), statep, sizeof(state_t));
+    newProcess->p_supportStruct = supportp;
+
+    if (!pagerFork(parent, supportp))
+    {
+        KINFO(("FORKPROCESS by pid %u: out of mapping records", currentProcess->p_pid));
+        freePcb(newProcess);
+        return -1;
+    }
+    shmHold(supportp); /* Cannot fail: the segments are the parent's */
+
+    /* The stack page is written at once anyway: copy it now */
+    pte = &supportp->sup_privatePgTbl[USERPGTBLSIZE - 1];
+    if (currentProcess->p_stack != NULL && (pte->pte_entryLO & PFNMASK) == (memaddr)currentProcess->p_stack)
+    {
+        newProcess->p_stack = allocPages(0);
+        if (newProcess->p_stack == NULL)
+        {
+            KINFO(("FORKPROCESS by pid %u: no stack page", currentProcess->p_pid));
+            pte->pte_entryLO = 0;
+            pagerRelease(supportp);
+            shmRelease(supportp);
+            freePcb(newProcess);
+            return -1;
+        }
+        memcopy(newProcess->p_stack, currentProcess->p_stack, PAGESIZE);
+        pte->pte_entryLO = (memaddr)newProcess->p_stack | VALIDON | DIRTYON;
+        tlbSyncPte(supportp, USERPGTBLSIZE - 1);
+    }
+
+    startProcess(newProcess);
+    return 0;
+}
+
 /**
  * Terminates a process and all its progeny recursively.
  * Recursively terminates all child processes, removes the process
  * from any associated semaphores, and cleans up the process tree.
+ * Each process leaves an accounting record: p with the given reason,
+ * its descendants with EXITKILLED.
  * If the terminated process is the current process, it is set to NULL.
  * If no processes remain, the system halts.
  */
-void sysTerminate(pcb_t *p)
+void sysTerminate(pcb_t *p, int reason)
 {
     if (p == NULL)
         return;
 
-    /* Recursively terminate all children */
+    /* Recursively terminate all children (still attached, so their
+       records name p as parent) */
     while (!emptyChild(p))
     {
-        sysTerminate(removeChild(p));
+        sysTerminate(p->p_child, EXITKILLED);
     }
 
+    acctRecord(p, reason);
+
+    /* A process waiting for the pager is soft-blocked on pagerSem */
+    if (p->p_semAdd == &pagerSem)
+    {
+        pagerCancel(p);
+    }
     /* If the process is blocked on a semaphore */
-    if (p->p_semAdd != NULL)
+    else if (p->p_semAdd != NULL)
     {
         int *semAddr = p->p_semAdd;
 
-        /* Check if it's NOT a device semaphore before adjusting */
-        if (!(semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES - 1]))
+        /* Check if it's NOT a device semaphore (or the pseudo-clock) before adjusting */
+        if (!(semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES]))
         {
             (*semAddr)++; /* Adjust the semaphore if it's NOT a device semaphore */
         }
@@ -209,7 +504,7 @@ void sysTerminate(pcb_t *p)
         outBlocked(p);
 
         /* If the process was soft-blocked (waiting for I/O), decrement softBlockCount */
-        if (semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES - 1])
+        if (semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES])
         {
             softBlockCount--;
         }
@@ -218,6 +513,17 @@ void sysTerminate(pcb_t *p)
     /* Remove process from the Ready Queue if it is in it */
     outProcQ(&readyQueue, p);
 
+    /* Give back the frames and segments of its address space, and its stack */
+    if (p->p_supportStruct != NULL)
+    {
+        pagerRelease(p->p_supportStruct);
+        shmRelease(p->p_supportStruct);
+    }
+    if (p->p_stack != NULL)
+    {
+        freeStack(p);
+    }
+
     /* If the process has a parent, detach it */
     if (p->p_prnt != NULL)
     {
@@ -240,9 +546,12 @@ void sysTerminate(pcb_t *p)
         processCount--;
     }
 
-    /* If no more processes exist, HALT */
+    /* If no more processes exist, write out the accounting records and HALT */
     if (processCount == 0)
     {
+        KINFO(("halt: all processes done"));
+        acctSync();
+        klogSync();
         HALT();
     }
 }
@@ -258,6 +567,9 @@ void sysPasseren(int *semaddr)
     /* Update CPU time */
     updateCPUTime();
 
+    /* Contention profile */
+    countPasseren(semaddr);
+
     /* Decrement the semaphore */
     (*semaddr)--;
 
@@ -298,6 +610,9 @@ void sysVerhogen(int *semAddr)
         {
             unblockedProcess->p_semAdd = NULL; /* Clear semaphore address */
 
+            chargeBlockedTime(unblockedProcess, semAddr);
+            RECORDWAKE(currentProcess, unblockedProcess, semAddr);
+
             insertProcQ(&readyQueue, unblockedProcess); /* Move to Ready Queue */
         }
     }
@@ -326,6 +641,12 @@ void sysWaitIO(state_t *savedState, int intLineNo, int devNum, int waitForTermRe
 
     int *semaddr = &(deviceSemaphores[deviceIndex]);
 
+    /* Per-process I/O accounting */
+    if (intLineNo >= DISKINT && intLineNo <= TERMINT)
+    {
+        currentProcess->p_ioCount[intLineNo - DISKINT]++;
+    }
+
     /* increment softBlockCount */
     softBlockCount++;
 
@@ -348,6 +669,29 @@ void sysGetCPUTime(state_t *savedState)
     savedState->s_v0 = currentProcess->p_time + (currentTOD - currentProcess->p_startTOD);
 }
 
+/**
+ * Copies the current process' accounting record (CPU time computed as
+ * in SYS6, I/O counts and blocked times) to the buffer in a1.
+ */
+void sysGetAccounting(state_t *savedState)
+{
+    procacct_t *acct = (procacct_t *)savedState->s_a1;
+    cpu_t currentTOD;
+    int i;
+
+    STCK(currentTOD);
+    acct->pa_cpuTime = currentProcess->p_time + (currentTOD - currentProcess->p_startTOD);
+    for (i = 0; i < DEVINTNUM; i++)
+    {
+        acct->pa_ioCount[i] = currentProcess->p_ioCount[i];
+    }
+    acct->pa_ioTime = currentProcess->p_ioTime;
+    acct->pa_clockTime = currentProcess->p_clockTime;
+    acct->pa_semTime = currentProcess->p_semTime;
+
+    savedState->s_v0 = 0;
+}
+
 /**
  * Performs a P opperation on the nucleus maintained pseudoclock
  * semaphore. Blocks the current process on the ASL, calls the
@@ -382,10 +726,15 @@ void programTrapHandler()
 }
 
 /**
- * Handles TLB exceptions.
+ * Handles TLB exceptions. Faults on pages of the nucleus pager are
+ * resolved by pageFault(), which only returns for the others.
  */
 void TLBExceptionHandler()
 {
+    if (currentProcess->p_supportStruct != NULL)
+    {
+        pageFault((state_t *)BIOSDATAPAGE);
+    }
     passUpOrDie(PGFAULTEXCEPT);
 }
 
@@ -404,6 +753,31 @@ void updateCPUTime()
     currentProcess->p_startTOD = currentTOD;
 }
 
+/**
+ * Charges the time p spent blocked on semAdd (since insertBlocked
+ * stamped p_blockTOD) to the matching accounting field: device
+ * semaphores and the pager, the pseudo-clock, or ordinary semaphores.
+ * Called on every path that unblocks a process.
+ */
+void chargeBlockedTime(pcb_t *p, int *semAdd)
+{
+    cpu_t currentTOD;
+    STCK(currentTOD);
+
+    if (semAdd == &deviceSemaphores[NUM_DEVICES])
+    {
+        p->p_clockTime += currentTOD - p->p_blockTOD;
+    }
+    else if ((semAdd >= &deviceSemaphores[0] && semAdd < &deviceSemaphores[NUM_DEVICES]) || semAdd == &pagerSem)
+    {
+        p->p_ioTime += currentTOD - p->p_blockTOD;
+    }
+    else
+    {
+        p->p_semTime += currentTOD - p->p_blockTOD;
+    }
+}
+
 /**
  * Handles Pass Up or Die mechanism for TLB exceptions, program traps, and SYSCALLs >= 9.
  * If the current process has a support structure, it passes the exception to the support level.
@@ -415,7 +789,8 @@ void passUpOrDie(int exceptType)
     if (currentProcess->p_supportStruct == NULL)
     {
         /* No support structure, terminate the process */
-        sysTerminate(currentProcess);
+        KWARN(("pid %u killed: exception %d with no support structure", currentProcess->p_pid, exceptType));
+        sysTerminate(currentProcess, EXITNOSUPPORT);
         scheduler();
     }
     else
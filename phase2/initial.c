@@ -13,6 +13,10 @@
 #include "../h/scheduler.h"
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
+#include "../h/klog.h"
+#include "../h/tlb.h"
+#include "../h/pager.h"
+#include "../h/palloc.h"
 #include "../h/types.h"
 #include "../h/const.h"
 
@@ -48,16 +52,18 @@ void main()
     passupvector_t *passupvector = (passupvector_t *)PASSUPVECTOR;
 
     /* Set the TLB Refill event handler */
-    passupvector->tlb_refll_handler = (memaddr)uTLB_RefillHandler;
+    passupvector->tlb_refll_handler = (memaddr)tlbRefillHandler;
     passupvector->tlb_refll_stackPtr = (memaddr)0x20001000;
 
     /* Set the Exception handler */
     passupvector->exception_handler = (memaddr)exceptionHandler;
     passupvector->exception_stackPtr = (memaddr)0x20001000;
 
-    /* Initialize Phase 1 data structures */
+    /* Initialize the page allocator, then the Phase 1 data structures on it */
+    initPages();
     initPcbs();
     initASL();
+    initPager();
 
     /* Initialize Nucleus variables */
     int i;
@@ -69,6 +75,8 @@ void main()
     /* Load the Interval Timer with 100 milliseconds */
     LDIT(CLOCKINTERVAL);
 
+    KINFO(("nucleus up: MAXPROC %d, QUANTUM %d us", MAXPROC, QUANTUM));
+
     /* Create Initial Process */
     createProcess();
 
@@ -15,6 +15,12 @@
 #include "../h/scheduler.h"
 #include "../h/initial.h"
 #include "../h/interrupts.h"
+#include "../h/waitgraph.h"
+#include "../h/stats.h"
+#include "../h/acct.h"
+#include "../h/kpage.h"
+#include "../h/klog.h"
+#include "../h/pager.h"
 #include "../h/const.h"
 
 /**
@@ -68,7 +74,7 @@ void interruptHandler()
 void handlePLTInterrupt()
 {
     /* Acknowledge the PLT interrupt by reloading the timer */
-    setTIMER(5000); /* Load PLT with 5ms */
+    setTIMER(QUANTUM); /* Load PLT with one time slice */
 
     /* Check if there's a current process */
     if (currentProcess != NULL)
@@ -102,6 +108,8 @@ void handleIntervalTimerInterrupt()
         pcb_t *unblockedProcess = removeBlocked(&deviceSemaphores[NUM_DEVICES]);
         if (unblockedProcess != NULL)
         {
+            softBlockCount--;                           /* It was soft-blocked by SYS7 */
+            chargeBlockedTime(unblockedProcess, &deviceSemaphores[NUM_DEVICES]);
             insertProcQ(&readyQueue, unblockedProcess); /* Move process to Ready Queue */
         }
     }
@@ -109,6 +117,11 @@ void handleIntervalTimerInterrupt()
     /* Reset the Pseudo-clock semaphore to 0 */
     deviceSemaphores[NUM_DEVICES] = 0;
 
+    /* Once-per-tick load sample, shared page and accounting write-out */
+    sampleLoad();
+    kpageTick();
+    acctTick();
+
     /* Restore execution state (LDST to return control) */
     if (currentProcess != NULL)
     {
@@ -136,11 +149,13 @@ void handleDeviceInterrupt(int intLine)
 
     /* Save the device's status register value BEFORE issuing ACK */
     unsigned int status;
+    int transmit = FALSE;
 
     if (intLine == TERMINT)
     {
         if (deviceReg->t_transm_status & 0xFF) /* If low byte is non-zero, it's a Transmitter interrupt */
         {
+            transmit = TRUE;
             status = deviceReg->t_transm_status;
             deviceReg->t_transm_command = ACK; /* Acknowledge Transmitter */
         }
@@ -156,6 +171,18 @@ void handleDeviceInterrupt(int intLine)
         deviceReg->d_command = ACK; /* Acknowledge non-terminal device */
     }
 
+    /* Completion of a nucleus accounting write, pager transfer or kernel log character:
+       no process waits on the device semaphore */
+    if ((intLine == FLASHINT && (acctInterrupt(devNum, status) || pagerInterrupt(devNum, status))) ||
+        (intLine == TERMINT && transmit && devNum == KLOGTERM && klogInterrupt(status)))
+    {
+        if (currentProcess == NULL)
+        {
+            scheduler();
+        }
+        LDST((state_t *)BIOSDATAPAGE);
+    }
+
     /* Compute the index in the deviceSemaphores array */
     int deviceIndex;
     if (intLine == TERMINT)
@@ -187,6 +214,9 @@ void handleDeviceInterrupt(int intLine)
             /* Store the device's status register value in v0 of the unblocked process */
             unblockedProcess->p_s.s_v0 = status;
 
+            chargeBlockedTime(unblockedProcess, semAddr);
+            RECORDWAKE(NULL, unblockedProcess, semAddr);
+
             /* Decrement the soft block count since a process is being unblocked */
             softBlockCount--;
 
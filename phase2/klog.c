@@ -0,0 +1,190 @@
+/************************** klog.c ******************************
+ *
+ * Non-blocking kernel log.
+ *
+ * klogBegin() and klogPrintf() (through the KERROR ... KDEBUG macros)
+ * format a message straight into klogRing, a KLOGSIZE byte ring, in
+ * time proportional to its length and without touching a device
+ * beyond starting the drain. Every message is one line,
+ * "<TOD> <level> <text>". A message that does not fit in the free
+ * space is dropped whole and counted in klogDropped; nothing queued is
+ * ever overwritten.
+ *
+ * The ring drains one character at a time to the transmitter of
+ * terminal KLOGTERM: the first message starts it, and each
+ * transmit-complete interrupt (klogInterrupt, called by
+ * handleDeviceInterrupt) sends the next character. No process waits
+ * for it. klogSync() flushes the rest by polling before HALT and PANIC.
+ * If the terminal is not installed the ring simply fills up.
+ *
+ * Formats: %d %u %x %s %c and %%.
+ ***************************************************************/
+
+#include <stdarg.h>
+#include "../h/klog.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+static char klogRing[KLOGSIZE];
+
+/* Free-running indexes: next character to send, next free byte, start
+   of the message being formatted (KLOGSIZE is a power of two) */
+static unsigned int klogHead = 0;
+static unsigned int klogTail = 0;
+static unsigned int klogMsg = 0;
+
+static int klogBusy = FALSE;  /* A character is being transmitted */
+static int klogFull = FALSE;  /* The current message ran out of room */
+unsigned int klogDropped = 0; /* Messages dropped for lack of room */
+
+/**
+ * Appends one character to the message being formatted.
+ */
+static void put(char c)
+{
+    if (klogTail - klogHead == KLOGSIZE)
+        klogFull = TRUE;
+    else
+        klogRing[klogTail++ % KLOGSIZE] = c;
+}
+
+/**
+ * Appends v in the given base, with a minus sign if neg.
+ */
+static void putNum(unsigned int v, unsigned int base, int neg)
+{
+    char digits[12];
+    int len = 0;
+
+    if (neg)
+        put('-');
+    do
+    {
+        digits[len++] = "0123456789abcdef"[v % base];
+        v /= base;
+    } while (v > 0);
+
+    while (len > 0)
+        put(digits[--len]);
+}
+
+/**
+ * Sends the next character if the terminal is idle.
+ */
+static void kick()
+{
+    device_t *term = DEV_REG_ADDR(TERMINT, KLOGTERM);
+
+    if (klogBusy || klogHead == klogMsg || (term->t_transm_status & 0xFF) == UNINSTALLED)
+        return;
+
+    term->t_transm_command = PRINTCHR | ((unsigned int)klogRing[klogHead % KLOGSIZE] << BYTELEN);
+    klogBusy = TRUE;
+}
+
+/**
+ * Starts a message: "<TOD> <level letter> ".
+ */
+void klogBegin(int level)
+{
+    cpu_t now;
+
+    STCK(now);
+    klogMsg = klogTail;
+    klogFull = FALSE;
+    putNum(now, 10, FALSE);
+    put(' ');
+    put("EWID"[level]);
+    put(' ');
+}
+
+/**
+ * Formats the text of the message begun by klogBegin() and queues it
+ * for the terminal.
+ */
+void klogPrintf(const char *fmt, ...)
+{
+    va_list ap;
+    char *s;
+    int d;
+
+    va_start(ap, fmt);
+    for (; *fmt != EOS && !klogFull; fmt++)
+    {
+        if (*fmt != '%')
+        {
+            put(*fmt);
+            continue;
+        }
+        switch (*++fmt)
+        {
+        case 'd':
+            d = va_arg(ap, int);
+            putNum(d < 0 ? -(unsigned int)d : (unsigned int)d, 10, d < 0);
+            break;
+        case 'u':
+            putNum(va_arg(ap, unsigned int), 10, FALSE);
+            break;
+        case 'x':
+            putNum(va_arg(ap, unsigned int), 16, FALSE);
+            break;
+        case 's':
+            for (s = va_arg(ap, char *); *s != EOS; s++)
+                put(*s);
+            break;
+        case 'c':
+            put((char)va_arg(ap, int));
+            break;
+        case EOS:
+            fmt--;
+            break;
+        default:
+            put(*fmt);
+        }
+    }
+    va_end(ap);
+    put('\n');
+
+    if (klogFull)
+    {
+        klogTail = klogMsg; /* Drop the whole message */
+        klogDropped++;
+    }
+    klogMsg = klogTail;
+    kick();
+}
+
+/**
+ * Called by handleDeviceInterrupt for a transmitter interrupt of
+ * terminal KLOGTERM, after the ACK. Returns TRUE if it was the log's
+ * character, which is then consumed (even on a transmission error, so
+ * a broken terminal cannot stall the log), and starts the next one.
+ */
+int klogInterrupt(unsigned int status)
+{
+    if (!klogBusy)
+        return FALSE;
+
+    klogBusy = FALSE;
+    klogHead++;
+    kick();
+    return TRUE;
+}
+
+/**
+ * Sends everything still queued by polling the terminal.
+ * Interrupts are off in the nucleus, so this is only used at shutdown.
+ */
+void klogSync()
+{
+    volatile device_t *term = DEV_REG_ADDR(TERMINT, KLOGTERM); /* Polled */
+
+    kick();
+    while (klogBusy)
+    {
+        while ((term->t_transm_status & 0xFF) == BUSY)
+            ;
+        term->t_transm_command = ACK;
+        klogInterrupt(term->t_transm_status);
+    }
+}
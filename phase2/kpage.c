@@ -0,0 +1,79 @@
+/************************** kpage.c ******************************
+ *
+ * Maintains the shared kernel data page.
+ *
+ * kernelPage is a page-aligned kpage_t that the nucleus rewrites on
+ * every dispatch (running process, its accumulated CPU time and slice
+ * start) and on every Interval Timer tick (system counters, load
+ * averages and the TLB refill and ASID recycle counts). GETKPAGE
+ * returns its address; processes only ever read it, and a VM-enabled
+ * process can be given a read-only mapping since the page holds
+ * nothing else.
+ *
+ * Readers use the sequence counter: kp_seq is odd while an update is
+ * in progress. A consistent snapshot is one read between two equal,
+ * even values of kp_seq:
+ *
+ *     do {
+ *         seq = kp->kp_seq;
+ *         ... copy fields ...
+ *     } while ((seq & 1) || seq != kp->kp_seq);
+ *
+ * The nucleus runs with interrupts off, so a reader only retries when
+ * it was preempted in the middle of its copy. A process' own CPU time
+ * is then kp_cpuTime + (TOD - kp_startTOD), SYS6 without the trap.
+ ***************************************************************/
+
+#include "../h/kpage.h"
+#include "../h/initial.h"
+#include "../h/stats.h"
+#include "../h/tlb.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+kpage_t kernelPage PAGEALIGNED;
+
+/**
+ * Publishes the process about to be dispatched; called by the
+ * scheduler after it stamped p_startTOD.
+ */
+void kpageDispatch(pcb_t *p)
+{
+    kernelPage.kp_seq++; /* Odd: update in progress */
+
+    kernelPage.kp_pid = p->p_pid;
+    kernelPage.kp_cpuTime = p->p_time;
+    kernelPage.kp_startTOD = p->p_startTOD;
+    kernelPage.kp_todBase = p->p_startTOD;
+    kernelPage.kp_switches++;
+
+    kernelPage.kp_seq++; /* Even: consistent again */
+}
+
+/**
+ * Publishes the system counters and load averages; called once per
+ * Interval Timer tick after the load sample.
+ */
+void kpageTick()
+{
+    loadstat_t load;
+    int i;
+
+    getLoadStats(&load);
+
+    kernelPage.kp_seq++;
+
+    STCK(kernelPage.kp_todBase);
+    kernelPage.kp_timeScale = *(unsigned int *)TIMESCALEADDR;
+    kernelPage.kp_ticks = load.ls_ticks;
+    kernelPage.kp_processCount = processCount;
+    kernelPage.kp_softBlockCount = softBlockCount;
+    for (i = 0; i < LOADPERIODS; i++)
+    {
+        kernelPage.kp_load[i] = load.ls_load[i];
+    }
+    kernelPage.kp_tlbRefills = tlbRefills;
+    kernelPage.kp_asidRecycles = asidRecycles;
+
+    kernelPage.kp_seq++;
+}
@@ -0,0 +1,258 @@
+/*********************************P2BENCH.C*******************************
+ *
+ *	Micro-benchmark program for the Pandos nucleus: phase 2.
+ *
+ *	Linked in place of p2test.c (make bench) it times the nucleus
+ *	primitives with the TOD clock and reports on Terminal0, one result
+ *	per line:
+ *
+ *		BENCH <name> <iterations> <total_us> <per_op_us>
+ *
+ *	followed by a final "BENCH_DONE" line. Any other output (progress,
+ *	the characters sent by the WAITIO test) never starts with "BENCH",
+ *	so a parser can simply keep the lines with that prefix.
+ *
+ *	Benchmarks:
+ *		null_syscall      SYS8 round trip (the cheapest SYSCALL)
+ *		pv_uncontended    P followed by V on a free semaphore
+ *		pingpong          V/P round trip between two processes
+ *		create_terminate  SYS1 of a child that V's once and does SYS2
+ *		plt_preempt       PLT interrupt, requeue and redispatch
+ *		waitio_term       one character written to Terminal0 with SYS5
+ *		waitclock         SYS7 round trip (about one pseudo-clock tick)
+ *		waitclock_jitter  spread (max - min) of the SYS7 intervals
+ */
+
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/p2print.h"
+#include <umps3/umps/libumps.h>
+
+typedef unsigned int devregtr;
+
+/* hardware constants */
+#define PRINTCHR		2
+#define BYTELEN			8
+#define RECVD			5
+#define TERMSTATMASK	0xFF
+#define TERM0ADDR		0x10000254
+
+#define QPAGE			1024
+#define CAUSEINTMASK	0xFD00
+
+/* system call codes */
+#define	CREATETHREAD	1	/* create thread */
+#define	TERMINATETHREAD	2	/* terminate thread */
+#define	PASSERN			3	/* P a semaphore */
+#define	VERHOGEN		4	/* V a semaphore */
+#define	WAITIO			5	/* delay on a io semaphore */
+#define	WAITCLOCK		7	/* delay on the clock semaphore */
+#define	GETSPTPTR		8	/* return support structure ptr. */
+
+/* iteration counts */
+#define SYSCALLLOOPS	1000
+#define PVLOOPS			1000
+#define PINGPONGLOOPS	500
+#define CREATELOOPS		100
+#define TERMCHARS		32
+#define CLOCKLOOPS		5
+
+#define SPINTIME		(20 * QUANTUM)	/* how long the PLT spinner runs */
+#define MAXGAPS			64
+#define CALIBLOOPS		100
+
+#define SEMAPHORE		int
+
+SEMAPHORE freesem = 1,		/* uncontended P/V */
+		ping = 0,			/* ping-pong, partner side */
+		pong = 0,			/* ping-pong, test side */
+		partnerdone = 0,	/* partner has finished its rounds */
+		childdone = 0,		/* create_terminate child ran */
+		spindone = 0;		/* PLT spinner finished */
+
+state_t partnerstate, childstate, spinstate;
+
+/* results of the PLT spinner */
+int		spingaps = 0;
+cpu_t	spingaptotal = 0;
+
+void	partner(), child(), spinner();
+
+
+/* prints one "BENCH <name> <iterations> <total_us> <per_op_us>" line */
+void report(char *name, int iters, cpu_t total) {
+	char	line[96];
+	int		pos = 0;
+
+	putstr(line, &pos, "BENCH ");
+	putstr(line, &pos, name);
+	putstr(line, &pos, " ");
+	putnum(line, &pos, iters);
+	putstr(line, &pos, " ");
+	putnum(line, &pos, total);
+	putstr(line, &pos, " ");
+	putnum(line, &pos, iters > 0 ? total / iters : 0);
+	putstr(line, &pos, "\n");
+	line[pos] = EOS;
+
+	print(line);
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*                 the root process                                  */
+/*                                                                   */
+void test() {
+	cpu_t	start, end, last, min, max;
+	int		i;
+	devregtr *base = (devregtr *) (TERM0ADDR);
+	devregtr status;
+
+	print("p2bench starts\n");
+
+	/* set up the states of the helper processes */
+	STST(&partnerstate);
+	partnerstate.s_sp = partnerstate.s_sp - QPAGE;
+	partnerstate.s_pc = partnerstate.s_t9 = (memaddr)partner;
+	partnerstate.s_status = partnerstate.s_status | IEPBITON | CAUSEINTMASK | TEBITON;
+
+	STST(&childstate);
+	childstate.s_sp = partnerstate.s_sp - QPAGE;
+	childstate.s_pc = childstate.s_t9 = (memaddr)child;
+	childstate.s_status = childstate.s_status | IEPBITON | CAUSEINTMASK | TEBITON;
+
+	STST(&spinstate);
+	spinstate.s_sp = childstate.s_sp - QPAGE;
+	spinstate.s_pc = spinstate.s_t9 = (memaddr)spinner;
+	spinstate.s_status = spinstate.s_status | IEPBITON | CAUSEINTMASK | TEBITON;
+
+	/* null syscall */
+	STCK(start);
+	for (i = 0; i < SYSCALLLOOPS; i++)
+		SYSCALL(GETSPTPTR, 0, 0, 0);
+	STCK(end);
+	report("null_syscall", SYSCALLLOOPS, end - start);
+
+	/* uncontended P/V */
+	STCK(start);
+	for (i = 0; i < PVLOOPS; i++) {
+		SYSCALL(PASSERN, (int)&freesem, 0, 0);
+		SYSCALL(VERHOGEN, (int)&freesem, 0, 0);
+	}
+	STCK(end);
+	report("pv_uncontended", PVLOOPS, end - start);
+
+	/* two-process semaphore ping-pong */
+	SYSCALL(CREATETHREAD, (int)&partnerstate, (int) NULL, 0);
+	STCK(start);
+	for (i = 0; i < PINGPONGLOOPS; i++) {
+		SYSCALL(VERHOGEN, (int)&ping, 0, 0);
+		SYSCALL(PASSERN, (int)&pong, 0, 0);
+	}
+	STCK(end);
+	SYSCALL(PASSERN, (int)&partnerdone, 0, 0);
+	report("pingpong", PINGPONGLOOPS, end - start);
+
+	/* SYS1 + SYS2 */
+	STCK(start);
+	for (i = 0; i < CREATELOOPS; i++) {
+		SYSCALL(CREATETHREAD, (int)&childstate, (int) NULL, 0);
+		SYSCALL(PASSERN, (int)&childdone, 0, 0);
+	}
+	STCK(end);
+	report("create_terminate", CREATELOOPS, end - start);
+
+	/* PLT preemption: the spinner runs alone while we are blocked */
+	SYSCALL(CREATETHREAD, (int)&spinstate, (int) NULL, 0);
+	SYSCALL(PASSERN, (int)&spindone, 0, 0);
+	report("plt_preempt", spingaps, spingaptotal);
+
+	/* WAITIO on a terminal character */
+	SYSCALL(PASSERN, (int)&term_mut, 0, 0);
+	STCK(start);
+	for (i = 0; i < TERMCHARS; i++) {
+		*(base + 3) = PRINTCHR | (((devregtr) '.') << BYTELEN);
+		status = SYSCALL(WAITIO, TERMINT, 0, 0);
+		if ((status & TERMSTATMASK) != RECVD)
+			PANIC();
+	}
+	STCK(end);
+	SYSCALL(VERHOGEN, (int)&term_mut, 0, 0);
+	print("\n");
+	report("waitio_term", TERMCHARS, end - start);
+
+	/* WAITCLOCK wakeup: align to a tick first, then time whole ticks */
+	SYSCALL(WAITCLOCK, 0, 0, 0);
+	STCK(start);
+	last = start;
+	min = MAXINT;
+	max = 0;
+	for (i = 0; i < CLOCKLOOPS; i++) {
+		SYSCALL(WAITCLOCK, 0, 0, 0);
+		STCK(end);
+		min = MIN(min, end - last);
+		max = MAX(max, end - last);
+		last = end;
+	}
+	report("waitclock", CLOCKLOOPS, end - start);
+	report("waitclock_jitter", 1, max - min);
+
+	print("BENCH_DONE\n");
+
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
+
+
+/* partner -- the other half of the ping-pong */
+void partner() {
+	int	i;
+
+	for (i = 0; i < PINGPONGLOOPS; i++) {
+		SYSCALL(PASSERN, (int)&ping, 0, 0);
+		SYSCALL(VERHOGEN, (int)&pong, 0, 0);
+	}
+
+	SYSCALL(VERHOGEN, (int)&partnerdone, 0, 0);
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
+
+
+/* child -- created and terminated by the create_terminate benchmark */
+void child() {
+	SYSCALL(VERHOGEN, (int)&childdone, 0, 0);
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
+
+
+/* spinner -- reads the TOD in a tight loop; any gap well above the */
+/* loop's own cost is time the nucleus took the CPU away            */
+void spinner() {
+	cpu_t	start, now, last, loop, threshold;
+	int		i;
+
+	/* calibrate: the shortest distance between two reads */
+	loop = MAXINT;
+	STCK(last);
+	for (i = 0; i < CALIBLOOPS; i++) {
+		STCK(now);
+		loop = MIN(loop, now - last);
+		last = now;
+	}
+	threshold = 10 * loop + 20;
+
+	STCK(start);
+	last = start;
+	now = start;
+	while (now - start < SPINTIME && spingaps < MAXGAPS) {
+		STCK(now);
+		if (now - last > threshold) {
+			spingaps++;
+			spingaptotal += now - last - loop;
+		}
+		last = now;
+	}
+
+	SYSCALL(VERHOGEN, (int)&spindone, 0, 0);
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
@@ -0,0 +1,439 @@
+/*********************************P2LOAD.C*******************************
+ *
+ *	Sustained-throughput workload program for the Pandos nucleus.
+ *
+ *	Linked in place of p2test.c (make load) it starts a mix of worker
+ *	processes through SYS1, lets them run for RUNTICKS pseudo-clock
+ *	ticks and then reports, per workload class, the completed work
+ *	units, the share of CPU time and the latency percentiles of a work
+ *	unit. Terminating the root process at the end kills all workers.
+ *
+ *	Worker classes (one work unit each):
+ *		cpu       LOOPWORK iterations of a busy loop
+ *		term      one LINELEN-character line written to Terminal1
+ *		print     one LINELEN-character line written to Printer0
+ *		disk      a seek plus a one-sector read from Disk0
+ *		pipe      one item travelling through a producer/stage/consumer
+ *		          chain of bounded buffers (counted at the consumer)
+ *
+ *	The workload shape is chosen at build time:
+ *		make load WORKLOAD=CPUBOUND | IOBOUND | PIPELINE | MIXED
+ *	(default MIXED). All shapes fit the default MAXPROC of 20.
+ *
+ *	Report on Terminal0, one line per class, then "LOAD_DONE":
+ *		LOAD <class> <procs> <units> <cpu_permille> <p50_us> <p90_us> <p99_us>
+ *	Classes without processes are omitted; devices that are not
+ *	installed simply produce no units.
+ */
+
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/p2print.h"
+#include <umps3/umps/libumps.h>
+
+typedef unsigned int devregtr;
+
+/* hardware constants */
+#define PRINTCHR		2
+#define BYTELEN			8
+#define RECVD			5
+#define TERMSTATMASK	0xFF
+#define TERM0ADDR		0x10000254
+#define SEEKCYL			2
+#define READBLK			3
+
+#define QPAGE			1024
+#define CAUSEINTMASK	0xFD00
+
+/* system call codes */
+#define	CREATETHREAD	1	/* create thread */
+#define	TERMINATETHREAD	2	/* terminate thread */
+#define	PASSERN			3	/* P a semaphore */
+#define	VERHOGEN		4	/* V a semaphore */
+#define	WAITIO			5	/* delay on a io semaphore */
+#define	GETCPUTIME		6	/* get cpu time used to date */
+#define	WAITCLOCK		7	/* delay on the clock semaphore */
+
+#define SEMAPHORE		int
+
+/* workload shapes */
+#define CPUBOUND		1
+#define IOBOUND			2
+#define PIPELINE		3
+#define MIXED			4
+
+#ifndef WORKLOAD
+#define WORKLOAD		MIXED
+#endif
+
+/* worker classes */
+#define CPUWORK			0
+#define TERMWORK		1
+#define PRINTWORK		2
+#define DISKWORK		3
+#define PIPEWORK		4
+#define NUMCLASSES		5
+
+#if WORKLOAD == CPUBOUND
+#define SHAPENAME		"cpubound"
+#define NCPU			12
+#define NTERM			1
+#define NPRINT			1
+#define NDISK			1
+#define NCHAINS			0
+#elif WORKLOAD == IOBOUND
+#define SHAPENAME		"iobound"
+#define NCPU			2
+#define NTERM			4
+#define NPRINT			4
+#define NDISK			4
+#define NCHAINS			0
+#elif WORKLOAD == PIPELINE
+#define SHAPENAME		"pipeline"
+#define NCPU			2
+#define NTERM			0
+#define NPRINT			0
+#define NDISK			0
+#define NCHAINS			4
+#else
+#define SHAPENAME		"mixed"
+#define NCPU			4
+#define NTERM			2
+#define NPRINT			2
+#define NDISK			2
+#define NCHAINS			2
+#endif
+
+#define CHAINLEN		4	/* producer, two stages, consumer */
+#define SLOTS			4	/* bounded buffer size */
+#define NWORKERS		(NCPU + NTERM + NPRINT + NDISK + NCHAINS * CHAINLEN)
+
+#define RUNTICKS		50	/* pseudo-clock ticks the mix runs for */
+#define LOOPWORK		2000
+#define STAGEWORK		200
+#define LINELEN			16
+#define MAXSAMPLES		128	/* latency samples kept per class */
+
+/* one bounded buffer between two pipeline stages */
+typedef struct buffer_t {
+	cpu_t		items[SLOTS];
+	int			head, tail;
+	SEMAPHORE	full, empty;
+} buffer_t;
+
+SEMAPHORE term1_mut = 1,		/* Terminal1 */
+		print_mut = 1,		/* Printer0 */
+		disk_mut = 1,		/* Disk0 */
+		stat_mut = 1;		/* statistics below */
+
+int		wclass[NWORKERS];	/* class of each worker */
+int		wunits[NWORKERS];	/* units completed, per worker */
+cpu_t	wcpu[NWORKERS];		/* CPU time used, per worker */
+cpu_t	samples[NUMCLASSES][MAXSAMPLES];
+int		nsamples[NUMCLASSES];
+
+buffer_t chains[NCHAINS + 1][CHAINLEN - 1];
+
+state_t	workerstate;
+memaddr	diskbuf;			/* DMA buffers, one page per disk reader */
+
+char	*classname[NUMCLASSES] = {"cpu", "term", "print", "disk", "pipe"};
+
+void	worker();
+
+
+/* records a finished work unit of worker id that started at start */
+void unitdone(int id, cpu_t start) {
+	cpu_t	now;
+	int		c = wclass[id];
+
+	STCK(now);
+	SYSCALL(PASSERN, (int)&stat_mut, 0, 0);
+	wunits[id]++;
+	wcpu[id] = SYSCALL(GETCPUTIME, 0, 0, 0);
+	samples[c][nsamples[c] % MAXSAMPLES] = now - start;
+	nsamples[c]++;
+	SYSCALL(VERHOGEN, (int)&stat_mut, 0, 0);
+}
+
+
+/* sorts the kept samples of a class and returns the pct percentile */
+cpu_t percentile(int c, int pct) {
+	int		n = MIN(nsamples[c], MAXSAMPLES);
+	int		i, j;
+	cpu_t	v;
+
+	if (n == 0)
+		return 0;
+
+	for (i = 1; i < n; i++) {
+		v = samples[c][i];
+		for (j = i; j > 0 && samples[c][j - 1] > v; j--)
+			samples[c][j] = samples[c][j - 1];
+		samples[c][j] = v;
+	}
+	return samples[c][((n - 1) * pct) / 100];
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*                 the root process                                  */
+/*                                                                   */
+void test() {
+	int		id = 0;
+	int		i, c, procs, units;
+	cpu_t	cpu, totalcpu;
+	char	line[96];
+	int		pos;
+
+	print("p2load starts: ");
+	print(SHAPENAME);
+	print("\n");
+
+	for (i = 0; i < NCPU; i++)
+		wclass[id++] = CPUWORK;
+	for (i = 0; i < NTERM; i++)
+		wclass[id++] = TERMWORK;
+	for (i = 0; i < NPRINT; i++)
+		wclass[id++] = PRINTWORK;
+	for (i = 0; i < NDISK; i++)
+		wclass[id++] = DISKWORK;
+	for (i = 0; i < NCHAINS * CHAINLEN; i++)
+		wclass[id++] = PIPEWORK;
+
+	for (c = 0; c < NCHAINS; c++) {
+		for (i = 0; i < CHAINLEN - 1; i++) {
+			chains[c][i].empty = SLOTS;
+			chains[c][i].full = 0;
+		}
+	}
+
+	/* worker stacks sit below ours, the disk buffers below the stacks */
+	STST(&workerstate);
+	diskbuf = ((workerstate.s_sp - (NWORKERS + 1) * QPAGE) & ~(PAGESIZE - 1)) - NDISK * PAGESIZE;
+
+	for (id = 0; id < NWORKERS; id++) {
+		workerstate.s_sp = workerstate.s_sp - QPAGE;
+		workerstate.s_pc = workerstate.s_t9 = (memaddr)worker;
+		workerstate.s_status = workerstate.s_status | IEPBITON | CAUSEINTMASK | TEBITON;
+		workerstate.s_a0 = id;
+		if (SYSCALL(CREATETHREAD, (int)&workerstate, (int) NULL, 0) < 0) {
+			print("error: cannot create worker\n");
+			PANIC();
+		}
+	}
+
+	for (i = 0; i < RUNTICKS; i++)
+		SYSCALL(WAITCLOCK, 0, 0, 0);
+
+	/* snapshot the counters, then report */
+	SYSCALL(PASSERN, (int)&stat_mut, 0, 0);
+
+	totalcpu = 0;
+	for (id = 0; id < NWORKERS; id++)
+		totalcpu += wcpu[id];
+
+	for (c = 0; c < NUMCLASSES; c++) {
+		procs = 0;
+		units = 0;
+		cpu = 0;
+		for (id = 0; id < NWORKERS; id++) {
+			if (wclass[id] == c) {
+				procs++;
+				units += wunits[id];
+				cpu += wcpu[id];
+			}
+		}
+		if (procs == 0)
+			continue;
+
+		pos = 0;
+		putstr(line, &pos, "LOAD ");
+		putstr(line, &pos, classname[c]);
+		putstr(line, &pos, " ");
+		putnum(line, &pos, procs);
+		putstr(line, &pos, " ");
+		putnum(line, &pos, units);
+		putstr(line, &pos, " ");
+		putnum(line, &pos, totalcpu > 0 ? (cpu / (totalcpu / 1000 + 1)) : 0);
+		putstr(line, &pos, " ");
+		putnum(line, &pos, percentile(c, 50));
+		putstr(line, &pos, " ");
+		putnum(line, &pos, percentile(c, 90));
+		putstr(line, &pos, " ");
+		putnum(line, &pos, percentile(c, 99));
+		putstr(line, &pos, "\n");
+		line[pos] = EOS;
+		print(line);
+	}
+
+	print("LOAD_DONE\n");
+
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);	/* takes all the workers with it */
+}
+
+
+/* cpu -- pure computation */
+void cpuwork(int id) {
+	cpu_t	start;
+	int		i;
+
+	for (;;) {
+		STCK(start);
+		for (i = 0; i < LOOPWORK; i++)
+			;
+		unitdone(id, start);
+	}
+}
+
+
+/* term -- lines on Terminal1 */
+void termwork(int id) {
+	devregtr *base = (devregtr *) (TERM0ADDR + DEVREGSIZE);
+	devregtr status;
+	cpu_t	start;
+	int		i;
+
+	if (((device_t *)base)->d_status == UNINSTALLED)
+		SYSCALL(TERMINATETHREAD, 0, 0, 0);
+
+	for (;;) {
+		STCK(start);
+		SYSCALL(PASSERN, (int)&term1_mut, 0, 0);
+		for (i = 0; i < LINELEN; i++) {
+			*(base + 3) = PRINTCHR | (((devregtr) (i < LINELEN - 1 ? 'a' + id : '\n')) << BYTELEN);
+			status = SYSCALL(WAITIO, TERMINT, 1, 0);
+			if ((status & TERMSTATMASK) != RECVD)
+				PANIC();
+		}
+		SYSCALL(VERHOGEN, (int)&term1_mut, 0, 0);
+		unitdone(id, start);
+	}
+}
+
+
+/* print -- lines on Printer0 */
+void printwork(int id) {
+	device_t *printer = DEV_REG_ADDR(PRNTINT, 0);
+	devregtr status;
+	cpu_t	start;
+	int		i;
+
+	if (printer->d_status == UNINSTALLED)
+		SYSCALL(TERMINATETHREAD, 0, 0, 0);
+
+	for (;;) {
+		STCK(start);
+		SYSCALL(PASSERN, (int)&print_mut, 0, 0);
+		for (i = 0; i < LINELEN; i++) {
+			printer->d_data0 = i < LINELEN - 1 ? 'a' + id : '\n';
+			printer->d_command = PRINTCHR;
+			status = SYSCALL(WAITIO, PRNTINT, 0, 0);
+			if ((status & TERMSTATMASK) != READY)
+				PANIC();
+		}
+		SYSCALL(VERHOGEN, (int)&print_mut, 0, 0);
+		unitdone(id, start);
+	}
+}
+
+
+/* disk -- seek and read one sector from Disk0 */
+void diskwork(int id) {
+	device_t *disk = DEV_REG_ADDR(DISKINT, 0);
+	memaddr	buf = diskbuf + (id - NCPU - NTERM - NPRINT) * PAGESIZE;
+	int		maxcyl, unit = 0;
+	cpu_t	start;
+
+	if (disk->d_status == UNINSTALLED)
+		SYSCALL(TERMINATETHREAD, 0, 0, 0);
+
+	maxcyl = (disk->d_data1 >> 16) & 0xFFFF;
+	if (maxcyl == 0)
+		maxcyl = 1;
+
+	for (;;) {
+		STCK(start);
+		SYSCALL(PASSERN, (int)&disk_mut, 0, 0);
+		disk->d_command = (((unit * 7 + id) % maxcyl) << BYTELEN) | SEEKCYL;
+		if ((SYSCALL(WAITIO, DISKINT, 0, 0) & TERMSTATMASK) != READY)
+			PANIC();
+		disk->d_data0 = buf;
+		disk->d_command = READBLK;		/* head 0, sector 0 */
+		if ((SYSCALL(WAITIO, DISKINT, 0, 0) & TERMSTATMASK) != READY)
+			PANIC();
+		SYSCALL(VERHOGEN, (int)&disk_mut, 0, 0);
+		unit++;
+		unitdone(id, start);
+	}
+}
+
+
+void put(buffer_t *b, cpu_t item) {
+	SYSCALL(PASSERN, (int)&b->empty, 0, 0);
+	b->items[b->tail] = item;
+	b->tail = (b->tail + 1) % SLOTS;
+	SYSCALL(VERHOGEN, (int)&b->full, 0, 0);
+}
+
+
+cpu_t get(buffer_t *b) {
+	cpu_t	item;
+
+	SYSCALL(PASSERN, (int)&b->full, 0, 0);
+	item = b->items[b->head];
+	b->head = (b->head + 1) % SLOTS;
+	SYSCALL(VERHOGEN, (int)&b->empty, 0, 0);
+	return item;
+}
+
+
+/* pipe -- stage of a producer/consumer chain; an item carries the */
+/* TOD of its production, so the consumer sees end-to-end latency  */
+void pipework(int id) {
+	int		first = NCPU + NTERM + NPRINT + NDISK;
+	int		chain = (id - first) / CHAINLEN;
+	int		stage = (id - first) % CHAINLEN;
+	cpu_t	item;
+	int		i;
+
+	for (;;) {
+		if (stage == 0)
+			STCK(item);
+		else
+			item = get(&chains[chain][stage - 1]);
+
+		for (i = 0; i < STAGEWORK; i++)
+			;
+
+		if (stage < CHAINLEN - 1)
+			put(&chains[chain][stage], item);
+		else
+			unitdone(id, item);
+	}
+}
+
+
+/* worker -- entry point of every worker, id arrives in a0 */
+void worker(int id) {
+	switch (wclass[id]) {
+		case CPUWORK:
+			cpuwork(id);
+			break;
+		case TERMWORK:
+			termwork(id);
+			break;
+		case PRINTWORK:
+			printwork(id);
+			break;
+		case DISKWORK:
+			diskwork(id);
+			break;
+		case PIPEWORK:
+			pipework(id);
+			break;
+	}
+
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
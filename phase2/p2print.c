@@ -0,0 +1,76 @@
+/*********************************P2PRINT.C*******************************
+ *
+ *	Terminal output for the phase 2 test programs p2bench.c, p2load.c
+ *	and p2stress.c, linked with each of them in place of p2test.c.
+ *
+ *	print() writes a string to Terminal0 with SYS5, holding term_mut so
+ *	lines from different processes do not interleave; a program that
+ *	writes to Terminal0 by other means takes term_mut as well.
+ *	putnum() and putstr() build a line in a buffer first.
+ */
+
+#include "../h/p2print.h"
+#include "../h/const.h"
+#include "../h/types.h"
+#include <umps3/umps/libumps.h>
+
+typedef unsigned int devregtr;
+
+/* hardware constants */
+#define PRINTCHR		2
+#define BYTELEN			8
+#define RECVD			5
+#define TERMSTATMASK	0xFF
+#define TERM0ADDR		0x10000254
+
+/* system call codes */
+#define	PASSERN			3	/* P a semaphore */
+#define	VERHOGEN		4	/* V a semaphore */
+#define	WAITIO			5	/* delay on a io semaphore */
+
+int term_mut = 1;			/* for mutual exclusion on terminal 0 */
+
+
+/* a procedure to print on terminal 0 */
+void print(char *msg) {
+
+	char *s = msg;
+	devregtr * base = (devregtr *) (TERM0ADDR);
+	devregtr status;
+
+	SYSCALL(PASSERN, (int)&term_mut, 0, 0);				/* P(term_mut) */
+	while (*s != EOS) {
+		*(base + 3) = PRINTCHR | (((devregtr) *s) << BYTELEN);
+		status = SYSCALL(WAITIO, TERMINT, 0, 0);
+		if ((status & TERMSTATMASK) != RECVD)
+			PANIC();
+		s++;
+	}
+	SYSCALL(VERHOGEN, (int)&term_mut, 0, 0);				/* V(term_mut) */
+}
+
+
+/* appends the decimal form of n to buf at *pos */
+void putnum(char *buf, int *pos, int n) {
+	char digits[12];
+	int	len = 0;
+
+	if (n < 0) {
+		buf[(*pos)++] = '-';
+		n = -n;
+	}
+	do {
+		digits[len++] = '0' + (n % 10);
+		n /= 10;
+	} while (n > 0);
+
+	while (len > 0)
+		buf[(*pos)++] = digits[--len];
+}
+
+
+/* appends the string s to buf at *pos */
+void putstr(char *buf, int *pos, char *s) {
+	while (*s != EOS)
+		buf[(*pos)++] = *s++;
+}
@@ -0,0 +1,290 @@
+/*********************************P2STRESS.C*******************************
+ *
+ *	Scale stress program for the Pandos nucleus.
+ *
+ *	Linked in place of p2test.c against a nucleus built with a large
+ *	MAXPROC (make stress, STRESSMAXPROC=n). It only uses SYS1-SYS7, so
+ *	it runs unchanged whatever the pcb/ASL implementation behind them,
+ *	and times each operation with the TOD clock as the population grows:
+ *
+ *	- wide:  sleepers are created in LEVELS batches, each blocking on its
+ *	         own semaphore; after every batch the SYS1 cost and a
+ *	         blocking V/P ping-pong (insertBlocked/removeBlocked against
+ *	         an ASL holding the whole population) are measured. The
+ *	         sleepers are then woken batch by batch, timing the V.
+ *	- trees: a 16-ary, a binary and a deep (chain) process tree are built
+ *	         (every node creates its own children and blocks on its own
+ *	         semaphore), then random live subtrees are killed until none
+ *	         is left. A node is killed by waking it: it V's the ack
+ *	         semaphore and SYS2's itself with all its progeny.
+ *
+ *	sysTerminate() is recursive on the one-page nucleus stack, so the
+ *	chain is limited to DEEPDEPTH nodes.
+ *
+ *	Results go to Terminal0 in the p2bench format,
+ *		BENCH <name> <count> <total_us> <per_op_us>
+ *	with the population in the name (e.g. stress_create_512), and the
+ *	run ends with "BENCH_DONE". Stacks are STACKSIZE bytes per process
+ *	below RAMTOP: the machine needs roughly MAXPROC * (STACKSIZE + 200)
+ *	bytes of RAM above the kernel image.
+ */
+
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/p2print.h"
+#include <umps3/umps/libumps.h>
+
+#define QPAGE			1024
+#define CAUSEINTMASK	0xFD00
+
+/* system call codes */
+#define	CREATETHREAD	1	/* create thread */
+#define	TERMINATETHREAD	2	/* terminate thread */
+#define	PASSERN			3	/* P a semaphore */
+#define	VERHOGEN		4	/* V a semaphore */
+
+#define SEMAPHORE		int
+
+#define NPROCS			(MAXPROC - 2)	/* all but the root and the partner */
+#define LEVELS			8
+#define STEP			(NPROCS / LEVELS)
+#define PINGS			100
+#define STACKSIZE		256
+#define DEEPDEPTH		MIN(NPROCS, 64)
+
+SEMAPHORE create_mut = 1,		/* protects nodestate */
+		ping = 0,			/* ping-pong, partner side */
+		pong = 0,			/* ping-pong, root side */
+		arrived = 0,		/* a sleeper or node is about to block */
+		gone = 0,			/* a sleeper is about to terminate */
+		ack = 0;			/* a node is about to kill its subtree */
+
+SEMAPHORE nodesem[NPROCS];
+char	alive[NPROCS];
+
+int		fanout, nodes;		/* shape of the current tree */
+memaddr	stackbase;			/* stack of process id is stackbase - id * STACKSIZE */
+state_t	rootstate, nodestate;
+unsigned int seed = 1;
+
+void	partner(), sleeper(), node();
+
+
+/* prints "BENCH stress_<name>_<pop> <count> <total_us> <per_op_us>" */
+void report(char *name, int pop, int count, cpu_t total) {
+	char	line[96];
+	int		pos = 0;
+
+	putstr(line, &pos, "BENCH stress_");
+	putstr(line, &pos, name);
+	putstr(line, &pos, "_");
+	putnum(line, &pos, pop);
+	putstr(line, &pos, " ");
+	putnum(line, &pos, count);
+	putstr(line, &pos, " ");
+	putnum(line, &pos, total);
+	putstr(line, &pos, " ");
+	putnum(line, &pos, count > 0 ? total / count : 0);
+	putstr(line, &pos, "\n");
+	line[pos] = EOS;
+
+	print(line);
+}
+
+
+/* creates process id running code; callable from any process */
+void spawn(void (*code)(), int id) {
+	SYSCALL(PASSERN, (int)&create_mut, 0, 0);
+	nodestate.s_sp = stackbase - id * STACKSIZE;
+	nodestate.s_pc = nodestate.s_t9 = (memaddr)code;
+	nodestate.s_a0 = id;
+	if (SYSCALL(CREATETHREAD, (int)&nodestate, (int) NULL, 0) < 0) {
+		print("error: out of pcbs\n");
+		PANIC();
+	}
+	SYSCALL(VERHOGEN, (int)&create_mut, 0, 0);
+}
+
+
+/* blocking V/P round trips with the partner */
+cpu_t pingpong() {
+	cpu_t	start, end;
+	int		i;
+
+	STCK(start);
+	for (i = 0; i < PINGS; i++) {
+		SYSCALL(VERHOGEN, (int)&ping, 0, 0);
+		SYSCALL(PASSERN, (int)&pong, 0, 0);
+	}
+	STCK(end);
+	return end - start;
+}
+
+
+/* builds a tree of n nodes with fanout f, kills random subtrees */
+void tree(char *name, int f, int n) {
+	cpu_t	start, end, killtime = 0, worst = 0;
+	int		i, lo, hi, x, killed, kills = 0;
+	char	buf[32];
+	int		pos = 0;
+
+	fanout = f;
+	nodes = n;
+	for (i = 0; i < n; i++) {
+		nodesem[i] = 0;
+		alive[i] = TRUE;
+	}
+
+	STCK(start);
+	spawn(node, 0);
+	for (i = 0; i < n; i++)
+		SYSCALL(PASSERN, (int)&arrived, 0, 0);
+	STCK(end);
+	putstr(buf, &pos, name);
+	putstr(buf, &pos, "_build");
+	buf[pos] = EOS;
+	report(buf, n, n, end - start);
+
+	killed = 0;
+	while (killed < n) {
+		seed = seed * 1103515245 + 12345;
+		x = (seed >> 16) % n;
+		while (!alive[x])
+			x = (x + 1) % n;
+
+		STCK(start);
+		SYSCALL(VERHOGEN, (int)&nodesem[x], 0, 0);
+		SYSCALL(PASSERN, (int)&ack, 0, 0);
+		STCK(end);
+		killtime += end - start;
+		worst = MAX(worst, end - start);
+		kills++;
+
+		/* mark the subtree dead, one level of the heap numbering at a time */
+		for (lo = hi = x; lo < n; lo = lo * f + 1, hi = hi * f + f) {
+			for (i = lo; i <= hi && i < n; i++) {
+				if (alive[i]) {
+					alive[i] = FALSE;
+					killed++;
+				}
+			}
+		}
+	}
+
+	pos = 0;
+	putstr(buf, &pos, name);
+	putstr(buf, &pos, "_kill");
+	buf[pos] = EOS;
+	report(buf, n, kills, killtime);
+
+	pos = 0;
+	putstr(buf, &pos, name);
+	putstr(buf, &pos, "_killmax");
+	buf[pos] = EOS;
+	report(buf, n, 1, worst);
+
+	/* a killed node gives its semaphore back through sysTerminate */
+	for (i = 0; i < n; i++) {
+		if (nodesem[i] != 0) {
+			print("error: semaphore of a killed node not restored\n");
+			PANIC();
+		}
+	}
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*                 the root process                                  */
+/*                                                                   */
+void test() {
+	cpu_t	start, end;
+	int		level, i, pop;
+
+	print("p2stress starts\n");
+
+	STST(&rootstate);
+	STST(&nodestate);
+	nodestate.s_status = nodestate.s_status | IEPBITON | CAUSEINTMASK | TEBITON;
+	stackbase = rootstate.s_sp - 2 * QPAGE;
+
+	/* the ping-pong partner lives for the whole run */
+	SYSCALL(PASSERN, (int)&create_mut, 0, 0);
+	nodestate.s_sp = rootstate.s_sp - QPAGE;
+	nodestate.s_pc = nodestate.s_t9 = (memaddr)partner;
+	SYSCALL(CREATETHREAD, (int)&nodestate, (int) NULL, 0);
+	SYSCALL(VERHOGEN, (int)&create_mut, 0, 0);
+
+	report("pingpong", 0, PINGS, pingpong());
+
+	/* wide: grow a population of blocked sleepers */
+	for (i = 0; i < NPROCS; i++)
+		nodesem[i] = 0;
+
+	for (level = 0; level < LEVELS; level++) {
+		pop = level * STEP;
+		STCK(start);
+		for (i = pop; i < pop + STEP; i++)
+			spawn(sleeper, i);
+		STCK(end);
+		for (i = 0; i < STEP; i++)
+			SYSCALL(PASSERN, (int)&arrived, 0, 0);
+		report("create", pop + STEP, STEP, end - start);
+		report("pingpong", pop + STEP, PINGS, pingpong());
+	}
+
+	for (level = LEVELS - 1; level >= 0; level--) {
+		pop = level * STEP;
+		STCK(start);
+		for (i = pop; i < pop + STEP; i++)
+			SYSCALL(VERHOGEN, (int)&nodesem[i], 0, 0);
+		STCK(end);
+		for (i = 0; i < STEP; i++)
+			SYSCALL(PASSERN, (int)&gone, 0, 0);
+		report("wake", pop + STEP, STEP, end - start);
+	}
+
+	/* trees: wide, binary and deep */
+	tree("wide", 16, NPROCS);
+	tree("binary", 2, NPROCS);
+	tree("deep", 1, DEEPDEPTH);
+
+	print("BENCH_DONE\n");
+
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);	/* takes the partner with it */
+}
+
+
+/* partner -- the other half of the ping-pong */
+void partner() {
+	for (;;) {
+		SYSCALL(PASSERN, (int)&ping, 0, 0);
+		SYSCALL(VERHOGEN, (int)&pong, 0, 0);
+	}
+}
+
+
+/* sleeper -- blocks on its own semaphore until woken, then leaves */
+void sleeper(int id) {
+	SYSCALL(VERHOGEN, (int)&arrived, 0, 0);
+	SYSCALL(PASSERN, (int)&nodesem[id], 0, 0);
+	SYSCALL(VERHOGEN, (int)&gone, 0, 0);
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
+
+
+/* node -- creates its children, blocks; when woken kills its subtree */
+void node(int id) {
+	int		i, child;
+
+	for (i = 1; i <= fanout; i++) {
+		child = id * fanout + i;
+		if (child < nodes)
+			spawn(node, child);
+	}
+
+	SYSCALL(VERHOGEN, (int)&arrived, 0, 0);
+	SYSCALL(PASSERN, (int)&nodesem[id], 0, 0);
+	SYSCALL(VERHOGEN, (int)&ack, 0, 0);
+	SYSCALL(TERMINATETHREAD, 0, 0, 0);
+}
@@ -0,0 +1,897 @@
+/************************** pager.c ******************************
+ *
+ * Demand paging with a flash-backed swap store, and copy-on-write.
+ *
+ * A process with a support structure may mark page table entries with
+ * PTEPAGED (plus PTEWRITABLE as needed, V off): the nucleus then owns
+ * the page and resolves its faults itself instead of passing them up.
+ * A paged entry that is not resident either names a block of flash
+ * SWAPFLASHDEV in its PFN field (PTEONFLASH: the page is a copy of that
+ * block) or is zero-filled on first touch. A support structure is one
+ * address space, used by one process at a time: spaces[] lists the ones
+ * attached to a live process, and SYS1 and FORKPROCESS refuse them.
+ *
+ * Swap blocks are reference counted in blockRefs[]: one reference per
+ * non-resident entry naming the block, and one for a frame holding a
+ * clean copy of it. pagerAttach() counts the blocks named by the page
+ * tables handed to SYS1; the free ones take the pager's write-backs. A
+ * block is never overwritten while referenced: a modified page is
+ * always written to a free block.
+ *
+ * Frames come from a block of NUMFRAMES pages taken from the page
+ * allocator at boot and described by frameTable; if the block cannot
+ * be had, paging is off and every fault is passed up. A frame may be
+ * mapped by several entries (FORKPROCESS shares a process' pages with
+ * its child): f_maps lists them, in pmap_t records from a slab cache.
+ * Writable pages shared that way are PTECOW and mapped without D; a
+ * write by a sharer other than the last copies the page to a frame of
+ * its own. Pages that are swapped out are shared through their block.
+ *
+ * blockFrame[] finds the frame holding a clean copy of a block, so a
+ * page is read in once however many entries name its block: processes
+ * running the same program image from the same blocks map the one copy
+ * of each text page. A fault on a block already in a frame maps that
+ * frame, read-only pages as they are and writable ones PTECOW.
+ *
+ * MIPS has no hardware reference bit, so it is sampled: when the clock
+ * hand passes a referenced frame it clears the reference and takes V
+ * away from its mappings (PTERESIDENT stays). The next access faults,
+ * sets the reference again and restores V without any I/O. A frame the
+ * hand finds unreferenced is the victim. Modified pages are found the
+ * same way: writable pages are mapped without D, and the first write's
+ * TLB-Modification exception sets D and marks the frame dirty. Only
+ * dirty frames are written back on eviction, and those go to the
+ * compressed RAM pool of zpool.c first: the flash only sees the pages
+ * the pool has no room for, and page-ins look in the pool first.
+ *
+ * Faults that need a frame filled are queued on pagerSem (they count as
+ * soft-blocked) and served one at a time by a small state machine:
+ * PGWRITE (victim being written out), PGREAD (page being read in) and
+ * PGMAP (page ready: map it, wake the process). Each flash completion
+ * (pagerInterrupt) advances it; zero-filled, copied and pooled pages
+ * need no I/O at all. A process killed while it waits is dropped from the
+ * queue; if its page was in flight the frame is freed once the I/O
+ * completes. A process whose fault cannot get a frame (all of them busy,
+ * or dirty with no free swap block) is terminated.
+ *
+ * The mapping records of a page being written out are kept on
+ * pgEvicted until the write completes. If it fails, the block holds
+ * nothing: the entries are mapped back to the frame, which still holds
+ * the page, and the process the frame was for is terminated.
+ ***************************************************************/
+
+#include "../h/pager.h"
+#include "../h/tlb.h"
+#include "../h/asl.h"
+#include "../h/pcb.h"
+#include "../h/exceptions.h"
+#include "../h/scheduler.h"
+#include "../h/initial.h"
+#include "../h/waitgraph.h"
+#include "../h/klog.h"
+#include "../h/palloc.h"
+#include "../h/slab.h"
+#include "../h/zpool.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+/* Pager states */
+#define PGIDLE  0
+#define PGWRITE 1
+#define PGREAD  2
+#define PGMAP   3
+
+#define NOFRAME -1
+#define NOBLOCK -1
+
+/* A page table entry mapping a frame */
+typedef struct pmap_t
+{
+    support_t *m_sup;      /* Address space */
+    int m_idx;             /* Its page table index */
+    struct pmap_t *m_next; /* Next mapping of the same frame */
+} pmap_t;
+
+/* Frame table entry */
+typedef struct frame_t
+{
+    pmap_t *f_maps; /* Entries mapping the frame, NULL if free */
+    int f_blk;      /* Swap block the frame is a clean copy of, or NOBLOCK */
+    int f_dirty;    /* Written since it was filled */
+    int f_ref;      /* Referenced since the clock hand last passed */
+    int f_busy;     /* Being written out, filled or copied from */
+} frame_t;
+
+static memaddr framePool; /* NUMFRAMES pages, 0 if paging is off */
+static frame_t frameTable[NUMFRAMES];
+static int clockHand = 0;
+static kcache_t pmapCache;
+
+/* Address spaces attached to a live process */
+static support_t *spaces[MAXPROC];
+static int numSpaces = 0;
+
+/* Swap blocks */
+static unsigned short blockRefs[MAXSWAPBLOCKS];
+static short blockFrame[MAXSWAPBLOCKS]; /* Frame holding a clean copy, or NOFRAME */
+static int swapBlocks; /* Blocks of the swap flash in use */
+static int freeBlocks; /* Of which unreferenced */
+static int blockHand = 0;
+
+/* Fault in service */
+static int pgStep = PGIDLE;
+static pcb_t *pgProc;    /* Faulting process, NULL once it has been killed */
+static support_t *pgSup; /* Its address space and page */
+static int pgIdx;
+static int pgFrame;      /* Frame being filled */
+static int pgSrc;        /* Frame copied from, or NOFRAME */
+static pmap_t *pgMap;    /* Mapping record for pgFrame */
+static pmap_t *pgEvicted; /* Entries naming the block of a PGWRITE */
+static int pgBlock;       /* That block */
+
+int pagerSem = 0; /* Processes waiting for a page */
+pagerstat_t pagerStats;
+
+/**
+ * Returns the physical address of frame f.
+ */
+static memaddr frameAddr(int f)
+{
+    return framePool + f * PAGESIZE;
+}
+
+/**
+ * Returns the frame a resident entry maps.
+ */
+static int frameOf(pteEntry_t *pte)
+{
+    return ((pte->pte_entryLO & PFNMASK) - framePool) / PAGESIZE;
+}
+
+/**
+ * Returns the swap block a PTEONFLASH entry names.
+ */
+static int blockOf(pteEntry_t *pte)
+{
+    return pte->pte_entryLO >> VPNSHIFT;
+}
+
+/**
+ * Returns the index of sup in spaces[], or -1 if it is not attached.
+ */
+static int spaceOf(support_t *sup)
+{
+    int i;
+
+    for (i = 0; i < numSpaces; i++)
+        if (spaces[i] == sup)
+            return i;
+    return -1;
+}
+
+/**
+ * Takes a reference to swap block b.
+ */
+static void holdBlock(int b)
+{
+    if (blockRefs[b]++ == 0)
+        freeBlocks--;
+}
+
+/**
+ * Drops a reference to swap block b.
+ */
+static void dropBlock(int b)
+{
+    if (--blockRefs[b] == 0)
+    {
+        zpoolFree(b);
+        freeBlocks++;
+    }
+}
+
+/**
+ * Returns a free swap block; there must be one. It stays free until a
+ * reference is taken.
+ */
+static int allocBlock()
+{
+    while (blockRefs[blockHand] != 0)
+        blockHand = (blockHand + 1) % swapBlocks;
+    return blockHand;
+}
+
+/**
+ * Makes frame fr no longer a clean copy of its block, if it was one.
+ */
+static void dropCopy(frame_t *fr)
+{
+    if (fr->f_blk != NOBLOCK)
+    {
+        blockFrame[fr->f_blk] = NOFRAME;
+        dropBlock(fr->f_blk);
+    }
+    fr->f_blk = NOBLOCK;
+}
+
+/**
+ * Marks frame fr free once its last mapping is gone.
+ */
+static void freeFrame(frame_t *fr)
+{
+    dropCopy(fr);
+    fr->f_dirty = FALSE;
+    fr->f_ref = FALSE;
+}
+
+/**
+ * Takes the mapping of page idx of sup off the list at link and returns
+ * it, or NULL if it is not on the list.
+ */
+static pmap_t *unlinkMap(pmap_t **link, support_t *sup, int idx)
+{
+    pmap_t *m;
+
+    while (*link != NULL && ((*link)->m_sup != sup || (*link)->m_idx != idx))
+        link = &(*link)->m_next;
+    m = *link;
+    if (m != NULL)
+        *link = m->m_next;
+    return m;
+}
+
+/**
+ * Frees a list of mapping records.
+ */
+static void freeMaps(pmap_t *m)
+{
+    pmap_t *next;
+
+    for (; m != NULL; m = next)
+    {
+        next = m->m_next;
+        kcacheFree(&pmapCache, m);
+    }
+}
+
+/**
+ * Starts a flash transfer of frame f to or from block blk.
+ */
+static void startFlash(unsigned int command, int f, unsigned int blk)
+{
+    device_t *flash = DEV_REG_ADDR(FLASHINT, SWAPFLASHDEV);
+
+    flash->d_data0 = frameAddr(f);
+    flash->d_command = (blk << BYTELEN) | command;
+}
+
+/**
+ * Advances the clock hand to the next victim: a free frame, or the
+ * first one not referenced since the hand last passed that can be
+ * written back if it has to. Returns NOFRAME if two turns find none.
+ */
+static int pickFrame()
+{
+    frame_t *fr;
+    pmap_t *m;
+    int i, n;
+
+    for (n = 0; n < 2 * NUMFRAMES; n++)
+    {
+        i = clockHand;
+        fr = &frameTable[i];
+        clockHand = (clockHand + 1) % NUMFRAMES;
+
+        if (fr->f_busy)
+            continue;
+        if (fr->f_maps == NULL)
+            return i;
+        if (fr->f_ref)
+        {
+            /* Second chance: sample the next reference */
+            fr->f_ref = FALSE;
+            for (m = fr->f_maps; m != NULL; m = m->m_next)
+            {
+                m->m_sup->sup_privatePgTbl[m->m_idx].pte_entryLO &= ~VALIDON;
+                tlbSyncPte(m->m_sup, m->m_idx);
+            }
+            continue;
+        }
+        if (!fr->f_dirty || freeBlocks > 0)
+            return i;
+    }
+    return NOFRAME;
+}
+
+/**
+ * Unmaps the page held by frame f from every entry mapping it; they
+ * then name the swap block holding it, if any. A dirty frame is saved
+ * in a free block: compressed into the RAM pool if it takes it, else
+ * written to the flash. Returns TRUE if a flash write has been started;
+ * the frame's mapping records are then on pgEvicted.
+ */
+static int evict(int f)
+{
+    frame_t *fr = &frameTable[f];
+    pmap_t *maps = fr->f_maps;
+    int dirty = fr->f_dirty;
+    int blk = dirty ? allocBlock() : fr->f_blk;
+    pteEntry_t *pte;
+    pmap_t *m;
+
+    for (m = maps; m != NULL; m = m->m_next)
+    {
+        pte = &m->m_sup->sup_privatePgTbl[m->m_idx];
+        pte->pte_entryLO &= ~(PFNMASK | VALIDON | DIRTYON | PTERESIDENT | PTECOW | PTEONFLASH);
+        if (blk != NOBLOCK)
+        {
+            pte->pte_entryLO |= PTEONFLASH | (blk << VPNSHIFT);
+            holdBlock(blk);
+        }
+        tlbSyncPte(m->m_sup, m->m_idx);
+    }
+    fr->f_maps = NULL;
+    freeFrame(fr);
+    pagerStats.pg_evictions++;
+
+    if (dirty && zpoolStore(blk, frameAddr(f)))
+        pagerStats.pg_zpoolOuts++;
+    else if (dirty)
+    {
+        startFlash(FLASHWRITEBLK, f, blk);
+        pagerStats.pg_pageOuts++;
+        pgEvicted = maps;
+        pgBlock = blk;
+        return TRUE;
+    }
+    freeMaps(maps);
+    return FALSE;
+}
+
+/**
+ * Maps the entries on pgEvicted back to frame pgFrame, whose write to
+ * their block failed: the page is still in the frame, and dirty.
+ */
+static void restoreEvicted()
+{
+    frame_t *fr = &frameTable[pgFrame];
+    pteEntry_t *pte;
+    pmap_t *m;
+
+    fr->f_maps = pgEvicted;
+    fr->f_dirty = TRUE;
+    pgEvicted = NULL;
+    for (m = fr->f_maps; m != NULL; m = m->m_next)
+    {
+        pte = &m->m_sup->sup_privatePgTbl[m->m_idx];
+        dropBlock(pgBlock);
+        pte->pte_entryLO &= ~(PFNMASK | PTEONFLASH);
+        pte->pte_entryLO |= frameAddr(pgFrame) | PTERESIDENT; /* V off: the next access is a reference */
+        if ((pte->pte_entryLO & PTEWRITABLE) && fr->f_maps->m_next != NULL)
+            pte->pte_entryLO |= PTECOW;
+        tlbSyncPte(m->m_sup, m->m_idx);
+    }
+}
+
+/**
+ * Wakes the process at the head of the pager's queue.
+ */
+static void wakeHead()
+{
+    pcb_t *p;
+
+    pagerSem++;
+    p = removeBlocked(&pagerSem);
+    chargeBlockedTime(p, &pagerSem);
+    RECORDWAKE(NULL, p, &pagerSem);
+    softBlockCount--;
+    insertProcQ(&readyQueue, p);
+}
+
+/**
+ * Maps the filled frame into the faulting process and wakes it up. A
+ * copy is mapped writable and dirty, in place of the faulting
+ * process' mapping of the shared frame.
+ */
+static void mapPage()
+{
+    pteEntry_t *pte = &pgSup->sup_privatePgTbl[pgIdx];
+    frame_t *fr = &frameTable[pgFrame];
+    unsigned int entryLo = pte->pte_entryLO & ~(PFNMASK | VALIDON | DIRTYON | PTECOW | PTEONFLASH);
+
+    if (pgSrc != NOFRAME)
+    {
+        kcacheFree(&pmapCache, unlinkMap(&frameTable[pgSrc].f_maps, pgSup, pgIdx));
+        if (frameTable[pgSrc].f_maps == NULL)
+            freeFrame(&frameTable[pgSrc]);
+        entryLo |= DIRTYON;
+        fr->f_dirty = TRUE;
+    }
+    else if (pte->pte_entryLO & PTEONFLASH)
+    {
+        fr->f_blk = blockOf(pte); /* The entry's reference passes to the frame */
+        blockFrame[fr->f_blk] = pgFrame;
+    }
+
+    pte->pte_entryLO = entryLo | frameAddr(pgFrame) | VALIDON | PTERESIDENT;
+    tlbSyncPte(pgSup, pgIdx);
+    pgMap->m_sup = pgSup;
+    pgMap->m_idx = pgIdx;
+    pgMap->m_next = NULL;
+    fr->f_maps = pgMap;
+    fr->f_ref = TRUE;
+
+    wakeHead();
+}
+
+/**
+ * Maps page idx of sup, which names a swap block, to the frame holding
+ * a clean copy of the block if there is one. Returns FALSE if there is
+ * none (or no mapping record): the page must be read in.
+ */
+static int shareBlock(support_t *sup, int idx)
+{
+    pteEntry_t *pte = &sup->sup_privatePgTbl[idx];
+    int f = blockFrame[blockOf(pte)];
+    frame_t *fr;
+    pmap_t *m;
+
+    if (f == NOFRAME || (m = kcacheAlloc(&pmapCache)) == NULL)
+        return FALSE;
+
+    fr = &frameTable[f];
+    dropBlock(blockOf(pte)); /* The frame holds its own reference */
+    pte->pte_entryLO &= ~(PFNMASK | PTEONFLASH);
+    pte->pte_entryLO |= frameAddr(f) | VALIDON | PTERESIDENT;
+    if (pte->pte_entryLO & PTEWRITABLE)
+        pte->pte_entryLO |= PTECOW;
+    tlbSyncPte(sup, idx);
+    m->m_sup = sup;
+    m->m_idx = idx;
+    m->m_next = fr->f_maps;
+    fr->f_maps = m;
+    fr->f_ref = TRUE;
+    pagerStats.pg_blockHits++;
+    return TRUE;
+}
+
+/**
+ * Runs the pager until it has to wait for the flash or has nothing
+ * left to do.
+ */
+static void advance()
+{
+    pteEntry_t *pte;
+    unsigned int *from, *to;
+    int i;
+
+    while (TRUE)
+    {
+        switch (pgStep)
+        {
+        case PGIDLE:
+            pgProc = headBlocked(&pagerSem);
+            if (pgProc == NULL)
+                return;
+            pgSup = pgProc->p_supportStruct;
+            pgIdx = (pgProc->p_s.s_entryHI >> VPNSHIFT) & (USERPGTBLSIZE - 1);
+            pte = &pgSup->sup_privatePgTbl[pgIdx];
+            pgSrc = NOFRAME;
+            if (pte->pte_entryLO & PTERESIDENT)
+            {
+                /* A write to a shared page: copy it, unless the others let go meanwhile */
+                pgSrc = frameOf(pte);
+                if (frameTable[pgSrc].f_maps->m_next == NULL)
+                {
+                    wakeHead(); /* It retries, and gets the page to itself */
+                    break;
+                }
+                frameTable[pgSrc].f_busy = TRUE; /* Not a victim while copied from */
+            }
+            else if ((pte->pte_entryLO & PTEONFLASH) && shareBlock(pgSup, pgIdx))
+            {
+                wakeHead(); /* Read in for another process while it waited */
+                break;
+            }
+
+            pgMap = kcacheAlloc(&pmapCache);
+            pgFrame = pgMap == NULL ? NOFRAME : pickFrame();
+            if (pgFrame == NOFRAME)
+            {
+                KWARN(("pager: no frame for pid %u", pgProc->p_pid));
+                if (pgMap != NULL)
+                    kcacheFree(&pmapCache, pgMap);
+                if (pgSrc != NOFRAME)
+                    frameTable[pgSrc].f_busy = FALSE;
+                sysTerminate(pgProc, EXITFAULT); /* Leaves the queue */
+                break;
+            }
+
+            frameTable[pgFrame].f_busy = TRUE;
+            if (frameTable[pgFrame].f_maps != NULL && evict(pgFrame))
+            {
+                pgStep = PGWRITE;
+                return;
+            }
+            /* Fall through: the frame is clean */
+        case PGWRITE:
+            pgStep = PGMAP;
+            if (pgProc == NULL)
+                break;
+            pte = &pgSup->sup_privatePgTbl[pgIdx];
+            to = (unsigned int *)frameAddr(pgFrame);
+            if (pgSrc != NOFRAME)
+            {
+                from = (unsigned int *)frameAddr(pgSrc);
+                for (i = 0; i < PAGESIZE / sizeof(unsigned int); i++)
+                    to[i] = from[i];
+                pagerStats.pg_copies++;
+            }
+            else if ((pte->pte_entryLO & PTEONFLASH) && zpoolLoad(blockOf(pte), frameAddr(pgFrame)))
+            {
+                pagerStats.pg_zpoolIns++;
+            }
+            else if (pte->pte_entryLO & PTEONFLASH)
+            {
+                startFlash(FLASHREADBLK, pgFrame, blockOf(pte));
+                pagerStats.pg_pageIns++;
+                pgStep = PGREAD;
+                return;
+            }
+            else
+            {
+                for (i = 0; i < PAGESIZE / sizeof(unsigned int); i++)
+                    to[i] = 0;
+                pagerStats.pg_zeroFills++;
+            }
+            break;
+        case PGREAD:
+        case PGMAP:
+            if (pgProc != NULL)
+                mapPage();
+            else
+                kcacheFree(&pmapCache, pgMap);
+            if (pgSrc != NOFRAME)
+                frameTable[pgSrc].f_busy = FALSE;
+            frameTable[pgFrame].f_busy = FALSE;
+            pgStep = PGIDLE;
+            break;
+        }
+    }
+}
+
+/**
+ * Takes the frames from the page allocator and marks them free, and
+ * sizes the swap store and sets up its RAM tier. Called once at boot,
+ * after initPages().
+ */
+void initPager()
+{
+    void *pool = allocPages(pagesOrder(NUMFRAMES * PAGESIZE));
+    int i;
+
+    kcacheInit(&pmapCache, "pmap", sizeof(pmap_t), NULL, 0, POOLPMAP);
+    pgEvicted = NULL;
+
+    swapBlocks = MIN(DEV_REG_ADDR(FLASHINT, SWAPFLASHDEV)->d_data1, MAXSWAPBLOCKS);
+    freeBlocks = swapBlocks;
+    initZpool();
+
+    if (pool == NULL)
+    {
+        KWARN(("pager: no room for %d frames, paging off", NUMFRAMES));
+        framePool = 0;
+        return;
+    }
+    framePool = (memaddr)pool;
+
+    for (i = 0; i < MAXSWAPBLOCKS; i++)
+        blockFrame[i] = NOFRAME;
+    for (i = 0; i < NUMFRAMES; i++)
+    {
+        frameTable[i].f_maps = NULL;
+        frameTable[i].f_blk = NOBLOCK;
+        frameTable[i].f_busy = FALSE;
+    }
+}
+
+/**
+ * Returns TRUE if sup is the address space of a live process.
+ */
+int pagerInUse(support_t *sup)
+{
+    return spaceOf(sup) >= 0;
+}
+
+/**
+ * Prepares the paged entries of an address space handed to SYS1: they
+ * start out not resident, and the swap blocks they name are counted.
+ * Returns FALSE, changing nothing, if one names a block past the swap
+ * store or the address space is in use (see pagerInUse).
+ */
+int pagerAttach(support_t *sup)
+{
+    pteEntry_t *pte;
+    int i;
+
+    if (pagerInUse(sup))
+        return FALSE;
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        pte = &sup->sup_privatePgTbl[i];
+        if ((pte->pte_entryLO & (PTEPAGED | PTEONFLASH)) == (PTEPAGED | PTEONFLASH) && blockOf(pte) >= swapBlocks)
+            return FALSE;
+    }
+    spaces[numSpaces++] = sup;
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        pte = &sup->sup_privatePgTbl[i];
+        if (!(pte->pte_entryLO & PTEPAGED))
+            continue;
+        pte->pte_entryLO &= ~(VALIDON | DIRTYON | PTERESIDENT | PTECOW);
+        if (pte->pte_entryLO & PTEONFLASH)
+            holdBlock(blockOf(pte));
+        else
+            pte->pte_entryLO &= ~PFNMASK;
+    }
+    return TRUE;
+}
+
+/**
+ * Returns TRUE if pte names the block being written out.
+ */
+static int inWrite(pteEntry_t *pte)
+{
+    return pgStep == PGWRITE && (pte->pte_entryLO & (PTEPAGED | PTEONFLASH)) == (PTEPAGED | PTEONFLASH) &&
+           blockOf(pte) == pgBlock;
+}
+
+/**
+ * Copies the page table of parent into child for FORKPROCESS. Non-paged
+ * entries are copied as they are (FORKPROCESS refuses writable ones but
+ * for the stack, which it copies); paged pages are shared, the writable
+ * ones copy-on-write. Returns FALSE, changing nothing, if there are not
+ * enough mapping records or child is in use.
+ */
+int pagerFork(support_t *parent, support_t *child)
+{
+    unsigned int asid = (child->sup_asid & (MAXASID - 1)) << ASIDSHIFT;
+    pteEntry_t *from, *to;
+    frame_t *fr;
+    pmap_t *maps = NULL;
+    pmap_t *m;
+    int i;
+
+    if (pagerInUse(child))
+        return FALSE;
+
+    /* Mapping records first, so that failing leaves nothing to undo */
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        if ((parent->sup_privatePgTbl[i].pte_entryLO & (PTEPAGED | PTERESIDENT)) != (PTEPAGED | PTERESIDENT) &&
+            !inWrite(&parent->sup_privatePgTbl[i]))
+            continue;
+        m = kcacheAlloc(&pmapCache);
+        if (m == NULL)
+        {
+            freeMaps(maps);
+            return FALSE;
+        }
+        m->m_next = maps;
+        maps = m;
+    }
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        from = &parent->sup_privatePgTbl[i];
+        to = &child->sup_privatePgTbl[i];
+        to->pte_entryHI = (from->pte_entryHI & ~ASIDMASK) | asid;
+
+        if ((from->pte_entryLO & (PTEPAGED | PTERESIDENT)) == (PTEPAGED | PTERESIDENT))
+        {
+            fr = &frameTable[frameOf(from)];
+            m = maps;
+            maps = m->m_next;
+            m->m_sup = child;
+            m->m_idx = i;
+            m->m_next = fr->f_maps;
+            fr->f_maps = m;
+            if (from->pte_entryLO & PTEWRITABLE)
+            {
+                from->pte_entryLO = (from->pte_entryLO & ~DIRTYON) | PTECOW;
+                tlbSyncPte(parent, i);
+            }
+            pagerStats.pg_shared++;
+        }
+        else if ((from->pte_entryLO & (PTEPAGED | PTEONFLASH)) == (PTEPAGED | PTEONFLASH))
+        {
+            if (inWrite(from))
+            {
+                /* Mapped back to the frame with the parent's if the write fails */
+                m = maps;
+                maps = m->m_next;
+                m->m_sup = child;
+                m->m_idx = i;
+                m->m_next = pgEvicted;
+                pgEvicted = m;
+            }
+            holdBlock(blockOf(from));
+            pagerStats.pg_shared++;
+        }
+        to->pte_entryLO = from->pte_entryLO;
+    }
+    spaces[numSpaces++] = child;
+    return TRUE;
+}
+
+/**
+ * Resolves a TLB exception of the current process on a PTEPAGED page:
+ * first write to a writable page, reference sample, page whose block
+ * is in a frame already, or missing page or write to a shared one (the
+ * process then waits for the pager). Does
+ * not return in those cases; returns if the page is not the pager's,
+ * for the exception to be passed up.
+ */
+void pageFault(state_t *savedState)
+{
+    support_t *sup = currentProcess->p_supportStruct;
+    unsigned int entryHi = savedState->s_entryHI;
+    int idx = (entryHi >> VPNSHIFT) & (USERPGTBLSIZE - 1);
+    pteEntry_t *pte = &sup->sup_privatePgTbl[idx];
+    int write = (savedState->s_cause & CAUSEMASK) >> 2 == TLBMODEXC;
+    frame_t *fr;
+
+    if (framePool == 0 || ((pte->pte_entryHI ^ entryHi) & VPNMASK) != 0 || !(pte->pte_entryLO & PTEPAGED))
+        return;
+    if (write && !(pte->pte_entryLO & PTEWRITABLE))
+        return; /* A write to a read-only page */
+
+    if (pte->pte_entryLO & PTERESIDENT)
+    {
+        fr = &frameTable[frameOf(pte)];
+        if (!write)
+        {
+            pagerStats.pg_softFaults++;
+        }
+        else if (!(pte->pte_entryLO & PTECOW) || fr->f_maps->m_next == NULL)
+        {
+            /* The page is this process' own: it now differs from any swap copy */
+            pte->pte_entryLO = (pte->pte_entryLO & ~PTECOW) | DIRTYON;
+            dropCopy(fr);
+            fr->f_dirty = TRUE;
+        }
+        else
+        {
+            fr = NULL; /* Shared: wait for a copy */
+        }
+
+        if (fr != NULL)
+        {
+            fr->f_ref = TRUE;
+            pte->pte_entryLO |= VALIDON;
+            tlbSyncPte(sup, idx);
+            LDST(savedState);
+        }
+    }
+    else if ((pte->pte_entryLO & PTEONFLASH) && shareBlock(sup, idx))
+    {
+        LDST(savedState); /* Another address space has it in */
+    }
+
+    /* Wait for the page */
+    pagerStats.pg_faults++;
+    updateCPUTime();
+    memcopy(&(currentProcess->p_s), savedState, sizeof(state_t));
+    pagerSem--;
+    insertBlocked(&pagerSem, currentProcess);
+    softBlockCount++;
+
+    if (pgStep == PGIDLE)
+        advance();
+    scheduler();
+}
+
+/**
+ * Called by handleDeviceInterrupt for flash interrupts, after the ACK.
+ * Returns TRUE if it completed a pager transfer.
+ */
+int pagerInterrupt(int devNum, unsigned int status)
+{
+    if (devNum != SWAPFLASHDEV || (pgStep != PGWRITE && pgStep != PGREAD))
+        return FALSE;
+
+    if ((status & 0xFF) != READY)
+    {
+        KERROR(("pager: flash error %x", status));
+        if (pgStep == PGWRITE)
+            restoreEvicted();
+        if (pgProc != NULL)
+        {
+            sysTerminate(pgProc, EXITFAULT); /* Clears pgProc */
+        }
+    }
+    else if (pgStep == PGWRITE)
+    {
+        freeMaps(pgEvicted);
+        pgEvicted = NULL;
+    }
+
+    advance();
+    return TRUE;
+}
+
+/**
+ * Copies the pager statistics to buf, with the gauges of the frames and
+ * swap blocks in use filled in.
+ */
+void getPagerStats(pagerstat_t *buf)
+{
+    pmap_t *m;
+    int i;
+
+    pagerStats.pg_frames = 0;
+    pagerStats.pg_maps = 0;
+    for (i = 0; framePool != 0 && i < NUMFRAMES; i++)
+    {
+        if (frameTable[i].f_maps != NULL)
+            pagerStats.pg_frames++;
+        for (m = frameTable[i].f_maps; m != NULL; m = m->m_next)
+            pagerStats.pg_maps++;
+    }
+    pagerStats.pg_blocks = swapBlocks - freeBlocks;
+    pagerStats.pg_blockRefs = 0;
+    for (i = 0; i < swapBlocks; i++)
+        pagerStats.pg_blockRefs += blockRefs[i];
+    *buf = pagerStats;
+}
+
+/**
+ * Takes p, which is being terminated, out of the pager's queue.
+ */
+void pagerCancel(pcb_t *p)
+{
+    pagerSem++;
+    outBlocked(p);
+    softBlockCount--;
+    if (p == pgProc)
+        pgProc = NULL; /* The transfer completes, then the frame is freed */
+}
+
+/**
+ * Gives back the frames and swap blocks of an address space whose
+ * process terminated. Its paged entries revert to zero-filled pages.
+ */
+void pagerRelease(support_t *sup)
+{
+    pteEntry_t *pte;
+    frame_t *fr;
+    int i;
+
+    i = spaceOf(sup);
+    if (i >= 0)
+        spaces[i] = spaces[--numSpaces];
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        pte = &sup->sup_privatePgTbl[i];
+        if (!(pte->pte_entryLO & PTEPAGED))
+            continue;
+
+        if (pte->pte_entryLO & PTERESIDENT)
+        {
+            fr = &frameTable[frameOf(pte)];
+            kcacheFree(&pmapCache, unlinkMap(&fr->f_maps, sup, i));
+            if (fr->f_maps == NULL)
+                freeFrame(fr);
+        }
+        else if (pte->pte_entryLO & PTEONFLASH)
+        {
+            if (inWrite(pte))
+                kcacheFree(&pmapCache, unlinkMap(&pgEvicted, sup, i));
+            dropBlock(blockOf(pte));
+        }
+        pte->pte_entryLO &= PTEPAGED | PTEWRITABLE;
+        tlbSyncPte(sup, i);
+    }
+}
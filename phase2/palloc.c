@@ -0,0 +1,217 @@
+/************************** palloc.c ******************************
+ *
+ * Allocates physical pages with a buddy system.
+ *
+ * The allocator owns the RAM from the end of the kernel image (the
+ * linker's _end, rounded up to a page) to ROOTSTACKPAGES pages below
+ * RAMTOP, where the first process and the stacks it carves for its
+ * children live. Page i is the page at pageBase + i * PAGESIZE; at
+ * most MAXPAGES are managed.
+ *
+ * A block of order k is 2^k pages starting at a page index that is a
+ * multiple of 2^k; its buddy is the block at index i ^ 2^k. Free blocks
+ * sit on one list per order (freeHead[]), doubly linked through
+ * freeNext[]/freePrev[]. Allocation takes a block from the smallest
+ * non-empty list of at least the wanted order and splits it, giving the
+ * upper halves back; freeing merges a block with its buddy for as long
+ * as the buddy is free and whole. Both walk at most PAGEORDERS lists.
+ *
+ * All bookkeeping is in the arrays below, never in the pages
+ * themselves, so the allocator neither needs the RAM mapped nor
+ * touches memory it has handed out. The first page of every block
+ * records the block's order and whether it is free.
+ *
+ * When no block is large enough, the empty slabs of the slab caches
+ * are reclaimed and the search is tried once more.
+ *
+ * Usage is reported as the POOLPAGES pool (in pages) and, with the
+ * per-order free block counts that show fragmentation, by GETPAGESTATS.
+ ***************************************************************/
+
+#include "../h/palloc.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/slab.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+#define NOPAGE -1 /* End of a free list */
+
+extern char _end[]; /* End of the kernel image, set by the linker */
+
+static memaddr pageBase;             /* Address of page 0 */
+static int numPages;                 /* Pages managed */
+static int freeHead[PAGEORDERS];     /* First free block of each order */
+static int freeNext[MAXPAGES];       /* Free list links, at the first page of a free block */
+static int freePrev[MAXPAGES];
+static char blockOrder[MAXPAGES];    /* Order of the block starting at a page */
+static char blockFree[MAXPAGES];     /* TRUE at the first page of a free block */
+
+pagestat_t pageStats;
+
+/**
+ * Puts the block at page i on the free list of its order.
+ */
+static void pushFree(int i, int order)
+{
+    blockOrder[i] = order;
+    blockFree[i] = TRUE;
+    freePrev[i] = NOPAGE;
+    freeNext[i] = freeHead[order];
+    if (freeHead[order] != NOPAGE)
+        freePrev[freeHead[order]] = i;
+    freeHead[order] = i;
+    pageStats.pa_blocks[order]++;
+}
+
+/**
+ * Takes the free block at page i off its free list.
+ */
+static void unlinkFree(int i)
+{
+    int order = blockOrder[i];
+
+    if (freePrev[i] != NOPAGE)
+        freeNext[freePrev[i]] = freeNext[i];
+    else
+        freeHead[order] = freeNext[i];
+    if (freeNext[i] != NOPAGE)
+        freePrev[freeNext[i]] = freePrev[i];
+    blockFree[i] = FALSE;
+    pageStats.pa_blocks[order]--;
+}
+
+/**
+ * Hands the RAM above the kernel image to the allocator, as the
+ * largest aligned blocks that fit. Called once at boot.
+ */
+void initPages()
+{
+    memaddr top = RAMTOP - ROOTSTACKPAGES * PAGESIZE;
+    int i, order;
+
+    /* The image may not be in RAM at all (the host simulator) */
+    pageBase = ((memaddr)_end + PAGESIZE - 1) & ~(PAGESIZE - 1);
+    if (pageBase < *(memaddr *)RAMBASEADDR)
+        pageBase = *(memaddr *)RAMBASEADDR;
+
+    numPages = top > pageBase ? (top - pageBase) / PAGESIZE : 0;
+    if (numPages > MAXPAGES)
+        numPages = MAXPAGES;
+
+    for (order = 0; order < PAGEORDERS; order++)
+        freeHead[order] = NOPAGE;
+
+    i = 0;
+    while (i < numPages)
+    {
+        order = PAGEORDERS - 1;
+        while ((i & ((1 << order) - 1)) != 0 || i + (1 << order) > numPages)
+            order--;
+        pushFree(i, order);
+        i += 1 << order;
+    }
+
+    pageStats.pa_pages = numPages;
+    pageStats.pa_free = numPages;
+    poolStats[POOLPAGES].ps_size = numPages;
+}
+
+/**
+ * Returns the smallest order of a block holding bytes, or PAGEORDERS
+ * if no block is that large.
+ */
+int pagesOrder(unsigned int bytes)
+{
+    int order = 0;
+
+    while (order < PAGEORDERS && (PAGESIZE << order) < bytes)
+        order++;
+    return order;
+}
+
+/**
+ * Allocates a block of 2^order pages. Returns its address, or NULL if
+ * no free block is large enough, even after reclaiming empty slabs.
+ */
+void *allocPages(int order)
+{
+    poolstat_t *ps = &poolStats[POOLPAGES];
+    int i, k;
+
+    k = order;
+    while (k < PAGEORDERS && freeHead[k] == NOPAGE)
+        k++;
+    if (k >= PAGEORDERS && kcacheReap() > 0)
+    {
+        k = order;
+        while (k < PAGEORDERS && freeHead[k] == NOPAGE)
+            k++;
+    }
+    if (k >= PAGEORDERS)
+    {
+        poolFailed(POOLPAGES);
+        return NULL;
+    }
+
+    i = freeHead[k];
+    unlinkFree(i);
+
+    /* Split down to the wanted order, freeing the upper halves */
+    while (k > order)
+    {
+        k--;
+        pushFree(i + (1 << k), k);
+        pageStats.pa_splits++;
+    }
+    blockOrder[i] = order;
+
+    pageStats.pa_allocs++;
+    pageStats.pa_free -= 1 << order;
+    ps->ps_inUse += 1 << order;
+    if (ps->ps_inUse > ps->ps_highWater)
+        ps->ps_highWater = ps->ps_inUse;
+
+    return (void *)(pageBase + i * PAGESIZE);
+}
+
+/**
+ * Frees a block returned by allocPages(), merging it with its free
+ * buddies.
+ */
+void freePages(void *addr)
+{
+    int i = ((memaddr)addr - pageBase) / PAGESIZE;
+    int order = blockOrder[i];
+    int buddy;
+
+    pageStats.pa_frees++;
+    pageStats.pa_free += 1 << order;
+    poolStats[POOLPAGES].ps_inUse -= 1 << order;
+
+    while (order < PAGEORDERS - 1)
+    {
+        buddy = i ^ (1 << order);
+        if (buddy + (1 << order) > numPages || !blockFree[buddy] || blockOrder[buddy] != order)
+            break;
+        unlinkFree(buddy);
+        pageStats.pa_merges++;
+        i = MIN(i, buddy);
+        order++;
+    }
+    pushFree(i, order);
+}
+
+/**
+ * Copies the allocator statistics to buf, with pa_largest set to the
+ * pages in the largest free block.
+ */
+void getPageStats(pagestat_t *buf)
+{
+    int order = PAGEORDERS - 1;
+
+    while (order >= 0 && pageStats.pa_blocks[order] == 0)
+        order--;
+    pageStats.pa_largest = order >= 0 ? 1 << order : 0;
+    *buf = pageStats;
+}
@@ -5,41 +5,41 @@
  * management, and process tree maintenance.
  *
  * Implementation Summary:
- * - pcbs are stored in a static array (pcbTable) and managed via a free list (pcbFree_h).
+ * - pcbs come from a slab cache (pcbCache) of at most MAXPROC objects.
  * - Process queues are circular, doubly linked lists where the tail pointer is updated as needed.
  * - Process trees are maintained using parent and sibling pointers for efficient traversal.
  * - Functions for allocation/deallocation and queue/tree manipulation are provided with consistent interfaces.
  ***************************************************************/
 
 #include "../h/pcb.h"
+#include "../h/slab.h"
 #include "../h/const.h"
  
-static pcb_t pcbTable[MAXPROC]; /* Static array for pcb storage */
-static pcb_t *pcbFree_h = NULL; /* Head of free pcb list */
+static kcache_t pcbCache;        /* pcb storage */
+static unsigned int nextPid = 1; /* Next process id handed out */
 
 /**
- * Frees a pcb and inserts it back into the pcbFree list.
+ * Frees a pcb and gives it back to pcbCache.
  */
 void freePcb(pcb_t *p)
 {
     if (p == NULL)
         return;
 
-    p->p_next = pcbFree_h; /* Insert pcb at the front of the free list */
-    pcbFree_h = p;
+    kcacheFree(&pcbCache, p);
 }
 
 /**
- * Allocates a pcb from the pcbFree list.
- * Returns a pointer to the pcb or NULL if the list is empty.
+ * Allocates a pcb from pcbCache.
+ * Returns a pointer to the pcb or NULL if MAXPROC pcbs are in use
+ * (or memory ran out).
  */
 pcb_t *allocPcb()
 {
-    if (pcbFree_h == NULL)
-        return NULL; /* No available pcb */
+    pcb_t *allocated = kcacheAlloc(&pcbCache);
 
-    pcb_t *allocated = pcbFree_h;  /* Get the first pcb */
-    pcbFree_h = pcbFree_h->p_next; /* Move head to next pcb */
+    if (allocated == NULL)
+        return NULL; /* No available pcb */
 
     /* Reset all fields */
     allocated->p_next = NULL;
@@ -50,7 +50,16 @@ pcb_t *allocPcb()
     allocated->p_sib_right = NULL;
     allocated->p_time = 0;
     allocated->p_semAdd = NULL;
+    allocated->p_blockTOD = 0;
+    allocated->p_pid = nextPid++;
+    STCK(allocated->p_createTOD);
+    allocated->p_switches = 0;
+    allocated->p_syscalls = 0;
+    allocated->p_ioTime = 0;
+    allocated->p_clockTime = 0;
+    allocated->p_semTime = 0;
     allocated->p_supportStruct = NULL;
+    allocated->p_stack = NULL;
 
     /* Initialize state_t fields */
     allocated->p_s.s_entryHI = 0;
@@ -64,22 +73,21 @@ pcb_t *allocPcb()
         allocated->p_s.s_reg[i] = 0;
     }
 
+    for (i = 0; i < DEVINTNUM; i++)
+    {
+        allocated->p_ioCount[i] = 0;
+    }
+
     return allocated;
 }
 
 /**
- * Initializes the pcbFree list to contain all elements of the static array.
- * Called once during data structure initialization.
+ * Sets up pcbCache. Called once during data structure initialization,
+ * after initPages().
  */
 void initPcbs()
 {
-    int i;
-    for (i = 0; i < MAXPROC - 1; i++)
-    {
-        pcbTable[i].p_next = &pcbTable[i + 1]; /* Link each pcb to the next one */
-    }
-    pcbTable[MAXPROC - 1].p_next = NULL; /* Last pcb points to NULL */
-    pcbFree_h = &pcbTable[0];            /* Head points to the first pcb */
+    kcacheInit(&pcbCache, "pcb", sizeof(pcb_t), NULL, MAXPROC, POOLPCB);
 }
 
 /**
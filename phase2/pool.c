@@ -0,0 +1,57 @@
+/************************** pool.c ******************************
+ *
+ * Accounts the fixed-size kernel pools: pcbs, semds, the ASL contention
+ * records, the accounting and wait-for graph rings, physical pages,
+ * pager mapping records, shared segments and compressed swap chunks.
+ *
+ * Each pool's owner calls poolGet() and poolPut() as it hands entries
+ * out and takes them back, and poolFailed() when it has to refuse one
+ * (or drop an entry, for the rings). poolStats[] keeps, per pool, its
+ * size, entries in use, high-water mark and refusals; GETPOOLSTATS
+ * copies it out. It is a plain global so the uMPS3 monitor can watch it.
+ ***************************************************************/
+
+#include "../h/pool.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+/* Kernel pool usage, indexed by POOLPCB ... POOLZPOOL */
+poolstat_t poolStats[NUMPOOLS] = {
+    {MAXPROC, 0, 0, 0},
+    {MAXPROC, 0, 0, 0},
+    {SEMSTATSIZE, 0, 0, 0},
+    {ACCTRINGSIZE, 0, 0, 0},
+    {WAITGRAPHSIZE, 0, 0, 0},
+    {0, 0, 0, 0},  /* Set by initPages() */
+    {0, 0, 0, 0},  /* No limit */
+    {MAXSEGMENTS, 0, 0, 0},
+    {0, 0, 0, 0}}; /* Set by initZpool() */
+
+/**
+ * Counts an entry taken from a kernel pool.
+ */
+void poolGet(int pool)
+{
+    poolstat_t *ps = &poolStats[pool];
+
+    ps->ps_inUse++;
+    if (ps->ps_inUse > ps->ps_highWater)
+        ps->ps_highWater = ps->ps_inUse;
+}
+
+/**
+ * Counts an entry given back to a kernel pool.
+ */
+void poolPut(int pool)
+{
+    if (poolStats[pool].ps_inUse > 0)
+        poolStats[pool].ps_inUse--;
+}
+
+/**
+ * Counts an allocation a kernel pool could not satisfy.
+ */
+void poolFailed(int pool)
+{
+    poolStats[pool].ps_failures++;
+}
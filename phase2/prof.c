@@ -0,0 +1,198 @@
+/************************** prof.c ******************************
+ *
+ * Function-level profiler for PROFILE builds.
+ *
+ * gcc's -finstrument-functions makes every nucleus function call
+ * __cyg_profile_func_enter() on entry and __cyg_profile_func_exit()
+ * on return. The hooks keep a shadow call stack of (function, entry
+ * TOD, time spent in callees) and, per function, a profTable record
+ * with the number of calls, the inclusive time (entry to return) and
+ * the exclusive time (inclusive minus callees). The table is an open
+ * addressing hash on the function address; functions that do not fit
+ * are counted in profDropped.
+ *
+ * The nucleus does not always return: scheduler(), the syscall and
+ * interrupt paths leave through LDST and the next exception starts
+ * over on a fresh kernel stack in exceptionHandler(). Its entry hook
+ * therefore closes every frame still open, ending them at the TOD of
+ * the last hook event so that no user-mode time is charged to the
+ * nucleus. A recursive function (sysTerminate) has each level's time
+ * in its inclusive total.
+ *
+ * GETPROFILE copies the records out, highest exclusive time first, with
+ * functions identified by address (look them up in the symbol table,
+ * e.g. kernel.stab.umps). DUMPPROFILE prints the PROFDUMP hottest ones
+ * on the kernel log terminal whatever KLOGLEVEL is.
+ ***************************************************************/
+
+#include "../h/prof.h"
+#include "../h/exceptions.h"
+#include "../h/klog.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+#ifdef PROFILE
+
+/* Shadow call stack entry */
+typedef struct profframe_t
+{
+    profrec_t *pf_rec; /* NULL if the function has no table record */
+    cpu_t pf_start;    /* TOD at entry */
+    cpu_t pf_child;    /* Time spent in callees */
+} profframe_t;
+
+static profrec_t profTable[PROFSIZE];
+static profframe_t profStack[PROFDEPTH];
+static int profDepth = 0;    /* Frames on profStack */
+static int profDeep = 0;     /* Calls nested beyond PROFDEPTH */
+static cpu_t profLast = 0;   /* TOD of the last hook event */
+unsigned int profDropped = 0; /* Calls of functions without a record */
+
+void __cyg_profile_func_enter(void *fn, void *site) NOINSTR;
+void __cyg_profile_func_exit(void *fn, void *site) NOINSTR;
+static profrec_t *findProf(memaddr fn) NOINSTR;
+static void closeFrame(cpu_t end) NOINSTR;
+
+/**
+ * Returns the record of function fn, claiming a free slot on its first
+ * call, or NULL if the table is full.
+ */
+static profrec_t *findProf(memaddr fn)
+{
+    int slot = (fn >> 2) % PROFSIZE;
+    int probes;
+
+    for (probes = 0; probes < PROFSIZE; probes++)
+    {
+        if (profTable[slot].pr_fn == fn)
+            return &profTable[slot];
+        if (profTable[slot].pr_fn == 0)
+        {
+            profTable[slot].pr_fn = fn;
+            return &profTable[slot];
+        }
+        slot = (slot + 1) % PROFSIZE;
+    }
+
+    return NULL;
+}
+
+/**
+ * Pops the innermost frame, charging it the time up to end.
+ */
+static void closeFrame(cpu_t end)
+{
+    profframe_t *f = &profStack[--profDepth];
+    cpu_t elapsed = end - f->pf_start;
+
+    if (f->pf_rec != NULL)
+    {
+        f->pf_rec->pr_inclusive += elapsed;
+        f->pf_rec->pr_exclusive += elapsed - f->pf_child;
+    }
+    if (profDepth > 0)
+        profStack[profDepth - 1].pf_child += elapsed;
+}
+
+/**
+ * Entry hook: counts the call and opens a frame for it.
+ */
+void __cyg_profile_func_enter(void *fn, void *site)
+{
+    profrec_t *rec = findProf((memaddr)fn);
+    cpu_t now;
+
+    STCK(now);
+
+    /* A new nucleus entry: whatever was open left through LDST */
+    if (fn == (void *)exceptionHandler)
+    {
+        while (profDepth > 0)
+            closeFrame(profLast);
+        profDeep = 0;
+    }
+
+    if (rec != NULL)
+        rec->pr_calls++;
+    else
+        profDropped++;
+
+    if (profDepth == PROFDEPTH)
+        profDeep++;
+    else
+    {
+        profStack[profDepth].pf_rec = rec;
+        profStack[profDepth].pf_start = now;
+        profStack[profDepth].pf_child = 0;
+        profDepth++;
+    }
+    profLast = now;
+}
+
+/**
+ * Exit hook: closes the frame of the returning function.
+ */
+void __cyg_profile_func_exit(void *fn, void *site)
+{
+    STCK(profLast);
+
+    if (profDeep > 0)
+        profDeep--;
+    else if (profDepth > 0)
+        closeFrame(profLast);
+}
+
+#endif
+
+/**
+ * Copies up to n profile records into buf, highest exclusive time
+ * first. Returns the number of records copied (always 0 without
+ * PROFILE). The table is left as it is.
+ */
+int getProfile(profrec_t *buf, int n)
+{
+    int copied = 0;
+
+#ifdef PROFILE
+    int i, j;
+
+    /* Insertion sort into buf, ties broken by call count; the table is small */
+    for (i = 0; i < PROFSIZE; i++)
+    {
+        profrec_t *r = &profTable[i];
+
+        if (r->pr_fn == 0)
+            continue;
+        for (j = copied; j > 0 && (buf[j - 1].pr_exclusive < r->pr_exclusive ||
+                                   (buf[j - 1].pr_exclusive == r->pr_exclusive && buf[j - 1].pr_calls < r->pr_calls));
+             j--)
+        {
+            if (j < n)
+                buf[j] = buf[j - 1];
+        }
+        if (j < n)
+            buf[j] = *r;
+        if (copied < n)
+            copied++;
+    }
+#endif
+
+    return copied;
+}
+
+/**
+ * Prints the PROFDUMP functions with the highest exclusive time on the
+ * kernel log, one "prof <address> <calls> <inclusive> <exclusive>"
+ * line each.
+ */
+void dumpProfile()
+{
+    profrec_t top[PROFDUMP];
+    int i, n = getProfile(top, PROFDUMP);
+
+    for (i = 0; i < n; i++)
+    {
+        KLOG(KLOGINFO, ("prof %x %u %d %d", top[i].pr_fn, top[i].pr_calls, top[i].pr_inclusive,
+                        top[i].pr_exclusive));
+    }
+}
@@ -14,6 +14,9 @@
 #include "../h/asl.h"
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
+#include "../h/kpage.h"
+#include "../h/klog.h"
+#include "../h/tlb.h"
 #include "../h/types.h"
 #include "../h/const.h"
 
@@ -31,6 +34,7 @@ void scheduler()
     {
         if (processCount == 0)
         {
+            klogSync();
             HALT(); /* No active processes, system halts */
         }
         else if (softBlockCount > 0)
@@ -41,12 +45,22 @@ void scheduler()
         }
         else
         {
+            KERROR(("deadlock: %d processes, none ready or soft-blocked", processCount));
+            klogSync();
             PANIC(); /* Deadlock detected */
         }
     }
 
-    /* Load the Process Local Timer (PLT) with 5 milliseconds */
-    setTIMER(5000);
+    /* Load the Process Local Timer (PLT) with one time slice */
+    setTIMER(QUANTUM);
+
+    /* CPU time is charged from here (updateCPUTime, SYS6) */
+    STCK(currentProcess->p_startTOD);
+    currentProcess->p_switches++;
+    kpageDispatch(currentProcess);
+
+    /* Tag the TLB entries it makes with its address space */
+    tlbLoadAsid(currentProcess);
 
     /* Load the process state and execute */
     LDST(&(currentProcess->p_s));
@@ -0,0 +1,250 @@
+/************************** shm.c ******************************
+ *
+ * Shared memory segments.
+ *
+ * A segment is a block of zeroed pages from the page allocator that
+ * the nucleus maps, at a page-aligned kuseg address of the caller's
+ * choosing, into the page tables of any number of address spaces:
+ * SHMCREATE makes one and maps it into the caller, SHMMAP maps an
+ * existing one by its id (an index into segTable) and SHMUNMAP takes a
+ * mapping away. Processes then exchange data through the segment
+ * without copies, and signal each other with P and V as usual.
+ *
+ * A mapped page is an entry with V, D and PTESHM set and the page in
+ * its PFN field; the pager leaves such entries alone. The segment a
+ * page belongs to is found from the PFN by a scan of segTable, which
+ * is short. Segments are reference counted by page table entry: every
+ * entry mapping one of their pages holds a reference, whether it was
+ * made by SHMCREATE or SHMMAP, handed to SYS1 or copied by
+ * FORKPROCESS. A segment is freed when its last entry goes, by
+ * SHMUNMAP or when the process owning the page table terminates.
+ *
+ * Segments in use are counted as the POOLSHM pool.
+ ***************************************************************/
+
+#include "../h/shm.h"
+#include "../h/tlb.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/palloc.h"
+#include "../h/klog.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+/* A segment; free while sg_pages is 0 */
+typedef struct shmseg_t
+{
+    memaddr sg_base; /* Its first page */
+    int sg_pages;    /* Pages in the segment */
+    int sg_refs;     /* Page table entries mapping its pages */
+} shmseg_t;
+
+static shmseg_t segTable[MAXSEGMENTS];
+
+/**
+ * Returns the segment holding the page an entry with PTESHM maps, or
+ * NULL if there is none.
+ */
+static shmseg_t *segOf(pteEntry_t *pte)
+{
+    memaddr page = pte->pte_entryLO & PFNMASK;
+    int i;
+
+    for (i = 0; i < MAXSEGMENTS; i++)
+    {
+        if (segTable[i].sg_pages != 0 && page >= segTable[i].sg_base &&
+            page < segTable[i].sg_base + segTable[i].sg_pages * PAGESIZE)
+            return &segTable[i];
+    }
+    return NULL;
+}
+
+/**
+ * Drops a reference to segment s, freeing it with the last one.
+ */
+static void dropSeg(shmseg_t *s)
+{
+    if (--s->sg_refs == 0)
+    {
+        freePages((void *)s->sg_base);
+        s->sg_pages = 0;
+        poolPut(POOLSHM);
+    }
+}
+
+/**
+ * Returns the page table index of va if pages pages from va can be
+ * mapped in sup: va is page aligned in kuseg, the pages stay below
+ * the stack page and none is already mapped. Returns -1 otherwise.
+ */
+static int mapIndex(support_t *sup, memaddr va, int pages)
+{
+    int idx, i;
+
+    if (va < KUSEG || (va & (PAGESIZE - 1)) != 0)
+        return -1;
+    idx = (va - KUSEG) / PAGESIZE;
+    if (idx + pages > USERPGTBLSIZE - 1)
+        return -1;
+    for (i = idx; i < idx + pages; i++)
+    {
+        if (sup->sup_privatePgTbl[i].pte_entryLO & (PTEPAGED | VALIDON))
+            return -1;
+    }
+    return idx;
+}
+
+/**
+ * Maps segment s at page table index idx of sup.
+ */
+static void mapSeg(support_t *sup, shmseg_t *s, int idx)
+{
+    unsigned int asid = (sup->sup_asid & (MAXASID - 1)) << ASIDSHIFT;
+    pteEntry_t *pte;
+    int i;
+
+    for (i = 0; i < s->sg_pages; i++)
+    {
+        pte = &sup->sup_privatePgTbl[idx + i];
+        pte->pte_entryHI = (KUSEG + (idx + i) * PAGESIZE) | asid;
+        pte->pte_entryLO = (s->sg_base + i * PAGESIZE) | VALIDON | DIRTYON | PTESHM;
+        tlbSyncPte(sup, idx + i);
+    }
+    s->sg_refs += s->sg_pages;
+}
+
+/**
+ * SHMCREATE: creates a segment of at least size bytes, zeroed, and
+ * maps it at va in sup. Returns its id, or -1 if sup is NULL, va
+ * cannot take it, or there is no free segment or block.
+ */
+int shmCreate(support_t *sup, unsigned int size, memaddr va)
+{
+    int pages = (size + PAGESIZE - 1) / PAGESIZE;
+    unsigned int *word;
+    shmseg_t *s;
+    int id, idx, i;
+
+    if (sup == NULL || pages == 0 || (idx = mapIndex(sup, va, pages)) < 0)
+        return -1;
+
+    for (id = 0; id < MAXSEGMENTS && segTable[id].sg_pages != 0; id++)
+        ;
+    if (id == MAXSEGMENTS)
+    {
+        poolFailed(POOLSHM);
+        return -1;
+    }
+    s = &segTable[id];
+
+    word = allocPages(pagesOrder(size));
+    if (word == NULL)
+    {
+        KINFO(("SHMCREATE: no block for %u bytes", size));
+        return -1;
+    }
+    for (i = 0; i < pages * PAGESIZE / sizeof(unsigned int); i++)
+        word[i] = 0;
+
+    s->sg_base = (memaddr)word;
+    s->sg_pages = pages;
+    s->sg_refs = 0;
+    poolGet(POOLSHM);
+    mapSeg(sup, s, idx);
+    KDEBUG(("shm %d: %d pages at %x", id, pages, s->sg_base));
+    return id;
+}
+
+/**
+ * SHMMAP: maps segment id at va in sup. Returns 0, or -1 if sup is
+ * NULL, there is no such segment or va cannot take it.
+ */
+int shmMap(support_t *sup, int id, memaddr va)
+{
+    int idx;
+
+    if (sup == NULL || id < 0 || id >= MAXSEGMENTS || segTable[id].sg_pages == 0)
+        return -1;
+    if ((idx = mapIndex(sup, va, segTable[id].sg_pages)) < 0)
+        return -1;
+    mapSeg(sup, &segTable[id], idx);
+    return 0;
+}
+
+/**
+ * SHMUNMAP: unmaps the segment mapped at va in sup, which must be the
+ * address its first page is mapped at, up to the first entry that no
+ * longer maps its next page. Returns 0, or -1 if no segment starts
+ * there.
+ */
+int shmUnmap(support_t *sup, memaddr va)
+{
+    pteEntry_t *pte;
+    shmseg_t *s;
+    memaddr base;
+    int idx, i, pages;
+
+    if (sup == NULL || va < KUSEG || (va & (PAGESIZE - 1)) != 0)
+        return -1;
+    idx = (va - KUSEG) / PAGESIZE;
+    if (idx >= USERPGTBLSIZE - 1)
+        return -1;
+    pte = &sup->sup_privatePgTbl[idx];
+    if (!(pte->pte_entryLO & PTESHM) || (s = segOf(pte)) == NULL ||
+        (pte->pte_entryLO & PFNMASK) != s->sg_base)
+        return -1;
+
+    /* s may be freed on the way */
+    base = s->sg_base;
+    pages = s->sg_pages;
+    for (i = 0; i < pages && (pte->pte_entryLO & (PFNMASK | PTESHM)) == ((base + i * PAGESIZE) | PTESHM); i++, pte++)
+    {
+        pte->pte_entryLO = 0;
+        tlbSyncPte(sup, idx + i);
+        dropSeg(s);
+    }
+    return 0;
+}
+
+/**
+ * Takes a reference for every segment page mapped in the page table
+ * of sup, handed to SYS1 or copied by FORKPROCESS. Returns FALSE,
+ * changing nothing, if an entry with PTESHM maps no segment.
+ */
+int shmHold(support_t *sup)
+{
+    int i;
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        if ((sup->sup_privatePgTbl[i].pte_entryLO & PTESHM) && segOf(&sup->sup_privatePgTbl[i]) == NULL)
+            return FALSE;
+    }
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        if (sup->sup_privatePgTbl[i].pte_entryLO & PTESHM)
+            segOf(&sup->sup_privatePgTbl[i])->sg_refs++;
+    }
+    return TRUE;
+}
+
+/**
+ * Unmaps every segment page from the page table of sup, whose process
+ * terminated.
+ */
+void shmRelease(support_t *sup)
+{
+    pteEntry_t *pte;
+    int i;
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        pte = &sup->sup_privatePgTbl[i];
+        if (pte->pte_entryLO & PTESHM)
+        {
+            dropSeg(segOf(pte));
+            pte->pte_entryLO = 0;
+            tlbSyncPte(sup, i);
+        }
+    }
+}
@@ -0,0 +1,250 @@
+/************************** slab.c ******************************
+ *
+ * Allocates fixed-size kernel objects from slab caches.
+ *
+ * A cache (kcache_t) holds objects of one type. Its memory comes in
+ * slabs of one page from the page allocator: a slab_t header at the
+ * start of the page followed by as many objects as fit. The free
+ * objects of a slab form a list threaded through their first word, so
+ * allocating or freeing an object is a handful of pointer moves, and
+ * the slab of an object is found by rounding its address down to the
+ * page.
+ *
+ * Each cache keeps its slabs on three lists: partial (some objects
+ * free, allocation looks here first), full and empty. A new slab is
+ * only taken from the page allocator when both partial and empty are
+ * exhausted. Empty slabs are kept for reuse until kcacheReap() gives
+ * them back; the page allocator calls it when it runs out of blocks.
+ *
+ * The optional constructor runs once per object, when its slab is
+ * created. Objects are expected to be freed in their constructed
+ * state, except for the first word, which holds the free list link
+ * while the object is free.
+ *
+ * A cache may be limited to a number of objects (MAXPROC pcbs, say).
+ * Such a cache takes the slabs for all of them at boot and is never
+ * reaped: the nucleus relies on having every pcb and semd it counted
+ * on, however short of pages the page allocator later runs. Usage is
+ * counted in its poolStats[] entry, and kc_slabs and kc_emptySlabs tell
+ * how much memory it holds.
+ ***************************************************************/
+
+#include "../h/slab.h"
+#include "../h/palloc.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/types.h"
+#include "../h/const.h"
+#include <umps3/umps/libumps.h>
+
+#define OBJALIGN sizeof(void *) /* Object and header alignment */
+#define ALIGNUP(n) (((n) + OBJALIGN - 1) & ~(OBJALIGN - 1))
+
+/* Slab header, at the start of the slab's page */
+typedef struct slab_t
+{
+    struct slab_t *sl_next; /* Neighbours on the cache's slab list */
+    struct slab_t *sl_prev;
+    void *sl_free;          /* First free object */
+    int sl_inUse;           /* Objects allocated */
+} slab_t;
+
+kcache_t *kcacheList = NULL; /* Every cache, for reaping */
+
+/**
+ * Returns the slab holding obj.
+ */
+static slab_t *slabOf(void *obj)
+{
+    return (slab_t *)((memaddr)obj & ~(PAGESIZE - 1));
+}
+
+/**
+ * Pushes slab s on the slab list *head.
+ */
+static void pushSlab(slab_t **head, slab_t *s)
+{
+    s->sl_prev = NULL;
+    s->sl_next = *head;
+    if (*head != NULL)
+        (*head)->sl_prev = s;
+    *head = s;
+}
+
+/**
+ * Takes slab s off the slab list *head.
+ */
+static void unlinkSlab(slab_t **head, slab_t *s)
+{
+    if (s->sl_prev != NULL)
+        s->sl_prev->sl_next = s->sl_next;
+    else
+        *head = s->sl_next;
+    if (s->sl_next != NULL)
+        s->sl_next->sl_prev = s->sl_prev;
+}
+
+/**
+ * Takes a page from the page allocator and carves it into free,
+ * constructed objects. Returns the new slab, or NULL if there is no
+ * page.
+ */
+static slab_t *growCache(kcache_t *c)
+{
+    slab_t *s = allocPages(0);
+    char *obj;
+    int i;
+
+    if (s == NULL)
+        return NULL;
+
+    s->sl_inUse = 0;
+    s->sl_free = NULL;
+    obj = (char *)s + ALIGNUP(sizeof(slab_t)) + (c->kc_perSlab - 1) * c->kc_size;
+    for (i = 0; i < c->kc_perSlab; i++)
+    {
+        if (c->kc_ctor != NULL)
+            c->kc_ctor(obj);
+        *(void **)obj = s->sl_free;
+        s->sl_free = obj;
+        obj -= c->kc_size;
+    }
+    c->kc_slabs++;
+    return s;
+}
+
+/**
+ * Sets up cache c for objects of size bytes, built by ctor (which may
+ * be NULL). At most limit objects are handed out (0: no limit); usage
+ * is counted in poolStats[pool], and the slabs for all of them are
+ * taken at once. Objects must fit in a slab page.
+ */
+void kcacheInit(kcache_t *c, char *name, unsigned int size, void (*ctor)(void *), int limit, int pool)
+{
+    slab_t *s;
+    int i;
+
+    c->kc_name = name;
+    c->kc_size = ALIGNUP(size);
+    c->kc_perSlab = (PAGESIZE - ALIGNUP(sizeof(slab_t))) / c->kc_size;
+    c->kc_ctor = ctor;
+    c->kc_limit = limit;
+    c->kc_pool = pool;
+    c->kc_partial = NULL;
+    c->kc_full = NULL;
+    c->kc_empty = NULL;
+    c->kc_slabs = 0;
+    c->kc_emptySlabs = 0;
+
+    if (c->kc_perSlab == 0)
+        PANIC(); /* Larger than a slab */
+
+    for (i = 0; i < c->kc_limit; i += c->kc_perSlab)
+    {
+        s = growCache(c);
+        if (s == NULL)
+            PANIC(); /* No room for the objects the nucleus counts on */
+        pushSlab(&c->kc_empty, s);
+        c->kc_emptySlabs++;
+    }
+
+    c->kc_next = kcacheList;
+    kcacheList = c;
+}
+
+/**
+ * Allocates an object from cache c. Returns it in its constructed
+ * state (but for the first word), or NULL if the cache is at its limit
+ * or out of memory.
+ */
+void *kcacheAlloc(kcache_t *c)
+{
+    slab_t *s = c->kc_partial;
+    void *obj;
+
+    if (c->kc_limit != 0 && poolStats[c->kc_pool].ps_inUse >= c->kc_limit)
+    {
+        poolFailed(c->kc_pool);
+        return NULL;
+    }
+
+    if (s == NULL)
+    {
+        s = c->kc_empty;
+        if (s != NULL)
+        {
+            unlinkSlab(&c->kc_empty, s);
+            c->kc_emptySlabs--;
+        }
+        else if ((s = growCache(c)) == NULL)
+        {
+            poolFailed(c->kc_pool);
+            return NULL;
+        }
+        pushSlab(&c->kc_partial, s);
+    }
+
+    obj = s->sl_free;
+    s->sl_free = *(void **)obj;
+    s->sl_inUse++;
+    if (s->sl_inUse == c->kc_perSlab)
+    {
+        unlinkSlab(&c->kc_partial, s);
+        pushSlab(&c->kc_full, s);
+    }
+
+    poolGet(c->kc_pool);
+    return obj;
+}
+
+/**
+ * Gives obj back to cache c.
+ */
+void kcacheFree(kcache_t *c, void *obj)
+{
+    slab_t *s = slabOf(obj);
+
+    if (s->sl_inUse == c->kc_perSlab)
+    {
+        unlinkSlab(&c->kc_full, s);
+        pushSlab(&c->kc_partial, s);
+    }
+
+    *(void **)obj = s->sl_free;
+    s->sl_free = obj;
+    s->sl_inUse--;
+    if (s->sl_inUse == 0)
+    {
+        unlinkSlab(&c->kc_partial, s);
+        pushSlab(&c->kc_empty, s);
+        c->kc_emptySlabs++;
+    }
+
+    poolPut(c->kc_pool);
+}
+
+/**
+ * Gives the empty slabs of every cache without a limit back to the
+ * page allocator. Returns the number of pages freed.
+ */
+int kcacheReap()
+{
+    kcache_t *c;
+    slab_t *s;
+    int pages = 0;
+
+    for (c = kcacheList; c != NULL; c = c->kc_next)
+    {
+        if (c->kc_limit != 0)
+            continue; /* Taken for good at boot */
+        while ((s = c->kc_empty) != NULL)
+        {
+            unlinkSlab(&c->kc_empty, s);
+            freePages(s);
+            c->kc_slabs--;
+            c->kc_emptySlabs--;
+            pages++;
+        }
+    }
+    return pages;
+}
@@ -0,0 +1,81 @@
+/************************** stats.c ******************************
+ *
+ * Keeps system load statistics.
+ *
+ * handleIntervalTimerInterrupt() calls sampleLoad() once per tick,
+ * after releasing the pseudo-clock waiters. A sample counts the
+ * processes that could use the CPU (Ready Queue plus the running one)
+ * and records softBlockCount and processCount; nothing is done at
+ * dispatch time. The load averages are exponentially weighted moving
+ * averages over 1, 5 and 15 ticks in fixed point with LOADFSHIFT
+ * fraction bits:
+ *
+ *     load = (load * e + n * (1 - e)),  e = exp(-1 / period)
+ *
+ * The histogram counts ticks by ready queue depth in power-of-two
+ * buckets: 0, 1, 2-3, 4-7, ... , the last bucket open-ended.
+ ***************************************************************/
+
+#include "../h/stats.h"
+#include "../h/initial.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+#define LOADFIXED (1 << LOADFSHIFT) /* 1.0 in fixed point */
+
+/* exp(-1 / period) in fixed point for periods of 1, 5 and 15 ticks */
+static const unsigned int loadExp[LOADPERIODS] = {753, 1677, 1916};
+
+static loadstat_t loadStats;
+
+/**
+ * Takes one load sample; called on every Interval Timer tick.
+ */
+void sampleLoad()
+{
+    unsigned int running = 0;
+    unsigned int bucket = 0;
+    pcb_t *p;
+    int i;
+
+    /* Walk the circular Ready Queue: once per tick, never per dispatch */
+    if (readyQueue != NULL)
+    {
+        p = readyQueue;
+        do
+        {
+            running++;
+            p = p->p_next;
+        } while (p != readyQueue);
+    }
+
+    while (bucket < RQHISTBUCKETS - 1 && (running >> bucket) != 0)
+        bucket++;
+    loadStats.ls_rqHist[bucket]++;
+
+    if (currentProcess != NULL)
+        running++;
+
+    /* load * e is split into whole and fractional parts to stay in 32 bits */
+    for (i = 0; i < LOADPERIODS; i++)
+    {
+        unsigned int load = loadStats.ls_load[i];
+
+        loadStats.ls_load[i] = (load >> LOADFSHIFT) * loadExp[i] +
+                               (((load & (LOADFIXED - 1)) * loadExp[i]) >> LOADFSHIFT) +
+                               running * (LOADFIXED - loadExp[i]);
+    }
+
+    loadStats.ls_ticks++;
+    loadStats.ls_running = running;
+    loadStats.ls_softBlocked = softBlockCount;
+    loadStats.ls_processes = processCount;
+}
+
+/**
+ * Copies the current load statistics into buf.
+ */
+void getLoadStats(loadstat_t *buf)
+{
+    *buf = loadStats;
+}
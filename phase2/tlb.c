@@ -0,0 +1,134 @@
+/************************** tlb.c ******************************
+ *
+ * Software-managed TLB refill and address space identifiers.
+ *
+ * tlbRefillHandler() is installed in the Pass Up Vector. On a TLB miss
+ * it loads the entry for the faulting page from the private page table
+ * of the current process (p_supportStruct->sup_privatePgTbl) into a
+ * random TLB slot and restarts the faulting instruction.
+ *
+ * A process owns USERPGTBLSIZE pages: text and data from KUSEG up, and
+ * the stack page just below 0xC0000000. Their VPNs differ in the low
+ * five bits (the stack page's are all ones), so the table index is the
+ * faulting VPN masked with USERPGTBLSIZE - 1 and the handler is one
+ * mask, one load and one compare. If the entry found is not the
+ * faulting page (an address outside the process' space, or a process
+ * without page tables) an invalid entry is written instead: the retry
+ * raises a TLB-Invalid exception, which goes through the usual Pass Up
+ * or Die. Page faults on valid-but-absent pages are the support
+ * level's business in the same way.
+ *
+ * TLB entries are tagged with the ASID of their address space: the
+ * refill handler writes the faulting EntryHi (VPN and current ASID),
+ * and tlbLoadAsid() puts the sup_asid of the process being dispatched
+ * into the EntryHi its LDST loads (ASID 0 for processes without a
+ * support structure). Entries of different processes therefore stay in
+ * the TLB across context switches. asidOwner[] remembers the address
+ * space (support structure) each ASID was last used for; when the
+ * support level hands an ASID to a new address space, its stale
+ * entries are invalidated on that space's first dispatch, and that is
+ * the only time the nucleus invalidates anything.
+ ***************************************************************/
+
+#include "../h/tlb.h"
+#include "../h/initial.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+unsigned int tlbRefills = 0;   /* TLB misses served */
+unsigned int asidRecycles = 0; /* ASIDs handed to a new address space */
+
+/* Address space each ASID was last loaded for */
+static support_t *asidOwner[MAXASID];
+
+/**
+ * Refills the TLB from the current process' page table.
+ */
+void tlbRefillHandler()
+{
+    state_t *savedState = (state_t *)BIOSDATAPAGE;
+    unsigned int entryHi = savedState->s_entryHI;
+    support_t *sup = currentProcess->p_supportStruct;
+    pteEntry_t *pte = NULL;
+
+    if (sup != NULL)
+        pte = &sup->sup_privatePgTbl[(entryHi >> VPNSHIFT) & (USERPGTBLSIZE - 1)];
+
+    setENTRYHI(entryHi);
+    if (pte != NULL && ((pte->pte_entryHI ^ entryHi) & VPNMASK) == 0)
+        setENTRYLO(pte->pte_entryLO);
+    else
+        setENTRYLO(0); /* Not valid: TLB-Invalid on retry */
+    TLBWR();
+    tlbRefills++;
+
+    LDST(savedState);
+}
+
+/**
+ * Replaces the TLB entry for entryHi (VPN and ASID), if there is one,
+ * after its page table entry changed.
+ */
+void tlbUpdate(unsigned int entryHi, unsigned int entryLo)
+{
+    setENTRYHI(entryHi);
+    TLBP();
+    if ((getINDEX() & TLBPMISS) == 0)
+    {
+        setENTRYLO(entryLo);
+        TLBWI();
+    }
+}
+
+/**
+ * Reloads the TLB entry of page idx of sup after its page table entry
+ * changed. Nothing to do unless sup still owns its ASID: otherwise its
+ * entries are flushed before it runs again.
+ */
+void tlbSyncPte(support_t *sup, int idx)
+{
+    unsigned int asid = sup->sup_asid & (MAXASID - 1);
+    pteEntry_t *pte = &sup->sup_privatePgTbl[idx];
+
+    if (asidOwner[asid] == sup)
+        tlbUpdate((pte->pte_entryHI & VPNMASK) | (asid << ASIDSHIFT), pte->pte_entryLO);
+}
+
+/**
+ * Invalidates the TLB entries tagged with asid, probing for each page of
+ * a process' address space.
+ */
+static void flushAsid(unsigned int asid)
+{
+    unsigned int vpn;
+    int i;
+
+    for (i = 0; i < USERPGTBLSIZE; i++)
+    {
+        vpn = (i == USERPGTBLSIZE - 1) ? USERSTACKVPN : KUSEG + i * PAGESIZE;
+        tlbUpdate(vpn | (asid << ASIDSHIFT), 0);
+    }
+}
+
+/**
+ * Sets the ASID of p's address space in the EntryHi that dispatching p
+ * will load, first clearing the TLB of another space's entries if the
+ * ASID has been recycled.
+ */
+void tlbLoadAsid(pcb_t *p)
+{
+    unsigned int asid = 0;
+
+    if (p->p_supportStruct != NULL)
+    {
+        asid = p->p_supportStruct->sup_asid & (MAXASID - 1);
+        if (asidOwner[asid] != p->p_supportStruct)
+        {
+            flushAsid(asid);
+            asidOwner[asid] = p->p_supportStruct;
+            asidRecycles++;
+        }
+    }
+
+    p->p_s.s_entryHI = (p->p_s.s_entryHI & ~ASIDMASK) | (asid << ASIDSHIFT);
+}
@@ -0,0 +1,81 @@
+/************************** waitgraph.c ******************************
+ *
+ * Records the wait-for relation between processes.
+ *
+ * When built with WAITGRAPH, sysVerhogen() and handleDeviceInterrupt()
+ * report every process they unblock. A record holds the waker (the
+ * process doing the V, NULL for a device interrupt), the wakee, the
+ * semaphore and how long the wakee was blocked (from p_blockTOD, set by
+ * insertBlocked). Records go into a fixed ring; when it is full the
+ * oldest record is overwritten and counted as a failure in
+ * poolStats[POOLWAITGRAPH]. GETWAITGRAPH copies records out oldest
+ * first and removes them from the ring.
+ *
+ * Processes are identified by pcb address, so an id is only meaningful
+ * until the pcb is reused; a consumer should drain the ring often.
+ ***************************************************************/
+
+#include "../h/waitgraph.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+#ifdef WAITGRAPH
+
+/* Ring of wakeup records */
+static waitrec_t waitRing[WAITGRAPHSIZE];
+
+/* Index of the oldest record and number of records held */
+static int waitHead = 0;
+static int waitCount = 0;
+
+/**
+ * Appends one wakeup to the ring, overwriting the oldest record
+ * if the ring is full.
+ */
+void recordWake(pcb_t *waker, pcb_t *wakee, int *semAdd)
+{
+    waitrec_t *rec;
+    cpu_t now;
+
+    if (waitCount == WAITGRAPHSIZE)
+    {
+        waitHead = (waitHead + 1) % WAITGRAPHSIZE; /* Drop the oldest */
+        waitCount--;
+        poolFailed(POOLWAITGRAPH);
+        poolPut(POOLWAITGRAPH);
+    }
+
+    STCK(now);
+    rec = &waitRing[(waitHead + waitCount) % WAITGRAPHSIZE];
+    rec->w_waker = waker;
+    rec->w_wakee = wakee;
+    rec->w_semAdd = semAdd;
+    rec->w_wait = now - wakee->p_blockTOD;
+    waitCount++;
+    poolGet(POOLWAITGRAPH);
+}
+
+#endif
+
+/**
+ * Moves up to n records, oldest first, from the ring into buf.
+ * Returns the number of records copied (always 0 without WAITGRAPH).
+ */
+int getWaitRecords(waitrec_t *buf, int n)
+{
+    int copied = 0;
+
+#ifdef WAITGRAPH
+    while (copied < n && waitCount > 0)
+    {
+        buf[copied++] = waitRing[waitHead];
+        waitHead = (waitHead + 1) % WAITGRAPHSIZE;
+        waitCount--;
+        poolPut(POOLWAITGRAPH);
+    }
+#endif
+
+    return copied;
+}
@@ -0,0 +1,243 @@
+/************************** zpool.c ******************************
+ *
+ * Compressed RAM tier of the swap store.
+ *
+ * When the pager evicts a modified page it first offers it here: the
+ * page is compressed and kept in a pool of ZPOOLPAGES pages taken from
+ * the page allocator at boot, under the swap block the pager chose for
+ * it. Only if the page does not compress to ZLIMIT bytes, or the pool
+ * has no room, is it written to the flash. Page-ins look here first, so
+ * a page that stayed in the pool costs a decompression instead of a
+ * flash read. The block stays the page's name either way, so the
+ * pager's reference counts and sharing are the same for both tiers;
+ * the compressed copy is dropped when the block is freed.
+ *
+ * The compressor is a small LZ77: a page becomes a sequence of tokens,
+ * either a run of 1..128 literal bytes (a byte 0..127 holding the
+ * length - 1, then the bytes) or a match of 3..130 bytes copied from
+ * 1..ZWINDOW bytes back (a byte 128 + length - 3, then offset - 1 in two
+ * bytes). Matches are found through a hash of the next three bytes
+ * that remembers where they were last seen; one probe per position
+ * keeps it fast rather than tight. Zero-filled and repetitive pages,
+ * the common case, shrink to a few dozen bytes.
+ *
+ * The pool is cut into ZCHUNKSIZE byte chunks; a compressed page takes
+ * a run of them, found first fit. Chunks in use are the POOLZPOOL pool,
+ * whose failures count pages turned away for want of room.
+ ***************************************************************/
+
+#include "../h/zpool.h"
+#include "../h/exceptions.h"
+#include "../h/pcb.h"
+#include "../h/pool.h"
+#include "../h/palloc.h"
+#include "../h/klog.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+#define ZCHUNKS   (ZPOOLPAGES * PAGESIZE / ZCHUNKSIZE)
+#define ZLIMIT    (PAGESIZE * 3 / 4) /* Pages compressing worse go to the flash */
+#define ZWINDOW   4096               /* Furthest a match may reach back */
+#define ZMINMATCH 3
+#define ZMAXMATCH (ZMINMATCH + 127)
+#define ZMAXRUN   128                /* Longest literal run */
+#define ZHASHBITS 10
+#define NOCHUNK   -1
+
+static unsigned char *zpool;              /* ZCHUNKS chunks, NULL if the tier is off */
+static char zused[ZCHUNKS];               /* TRUE for chunks in use */
+static short zstart[MAXSWAPBLOCKS];       /* First chunk of a block's page, or NOCHUNK */
+static unsigned short zlen[MAXSWAPBLOCKS]; /* Its compressed length */
+static unsigned short zhash[1 << ZHASHBITS]; /* Last position + 1 of a 3 byte hash, 0 if none */
+static unsigned char zbuf[ZLIMIT];        /* Compressor output */
+
+/**
+ * Hashes the three bytes at p.
+ */
+static int hash3(unsigned char *p)
+{
+    unsigned int v = (p[0] << 16) | (p[1] << 8) | p[2];
+
+    return (v * 2654435761u) >> (32 - ZHASHBITS);
+}
+
+/**
+ * Appends the literals src[from..to) to out, whose length is *o.
+ * Returns FALSE if they do not fit in ZLIMIT bytes.
+ */
+static int putLiterals(unsigned char *src, int from, int to, unsigned char *out, int *o)
+{
+    int n;
+
+    while (from < to)
+    {
+        n = MIN(to - from, ZMAXRUN);
+        if (*o + 1 + n > ZLIMIT)
+            return FALSE;
+        out[(*o)++] = n - 1;
+        while (n-- > 0)
+            out[(*o)++] = src[from++];
+    }
+    return TRUE;
+}
+
+/**
+ * Compresses the page at src into zbuf. Returns the compressed length,
+ * or 0 if it is over ZLIMIT.
+ */
+static int compress(unsigned char *src)
+{
+    int i = 0, lit = 0, o = 0;
+    int h, cand, len;
+
+    for (h = 0; h < (1 << ZHASHBITS); h++)
+        zhash[h] = 0;
+
+    while (i + ZMINMATCH <= PAGESIZE)
+    {
+        h = hash3(&src[i]);
+        cand = zhash[h] - 1;
+        zhash[h] = i + 1;
+        if (cand < 0 || i - cand > ZWINDOW || src[cand] != src[i] ||
+            src[cand + 1] != src[i + 1] || src[cand + 2] != src[i + 2])
+        {
+            i++;
+            continue;
+        }
+
+        len = ZMINMATCH;
+        while (i + len < PAGESIZE && len < ZMAXMATCH && src[cand + len] == src[i + len])
+            len++;
+        if (!putLiterals(src, lit, i, zbuf, &o) || o + 3 > ZLIMIT)
+            return 0;
+        zbuf[o++] = 0x80 | (len - ZMINMATCH);
+        zbuf[o++] = (i - cand - 1) >> 8;
+        zbuf[o++] = (i - cand - 1) & 0xFF;
+        i += len;
+        lit = i;
+    }
+    if (!putLiterals(src, lit, PAGESIZE, zbuf, &o))
+        return 0;
+    return o;
+}
+
+/**
+ * Expands len compressed bytes at src into the page at dst.
+ */
+static void decompress(unsigned char *src, int len, unsigned char *dst)
+{
+    unsigned char *end = src + len;
+    unsigned char *from;
+    int n;
+
+    while (src < end)
+    {
+        n = *src++;
+        if (n < 0x80)
+        {
+            for (n++; n > 0; n--)
+                *dst++ = *src++;
+        }
+        else
+        {
+            from = dst - ((src[0] << 8) | src[1]) - 1;
+            src += 2;
+            for (n = n - 0x80 + ZMINMATCH; n > 0; n--)
+                *dst++ = *from++; /* Forwards: a match may overlap its own output */
+        }
+    }
+}
+
+/**
+ * Takes the pool from the page allocator. Called once at boot, by
+ * initPager().
+ */
+void initZpool()
+{
+    int i;
+
+    for (i = 0; i < MAXSWAPBLOCKS; i++)
+        zstart[i] = NOCHUNK;
+
+    zpool = allocPages(pagesOrder(ZPOOLPAGES * PAGESIZE));
+    if (zpool == NULL)
+    {
+        KWARN(("zpool: no room for %d pages, compressed swap off", ZPOOLPAGES));
+        return;
+    }
+    poolStats[POOLZPOOL].ps_size = ZCHUNKS;
+}
+
+/**
+ * Compresses the page at page into the pool as the contents of swap
+ * block blk. Returns FALSE if the tier is off, the page does not
+ * compress well enough or there is no room: it must go to the flash.
+ */
+int zpoolStore(int blk, memaddr page)
+{
+    poolstat_t *ps = &poolStats[POOLZPOOL];
+    int len, n, start, run, i;
+
+    if (zpool == NULL || (len = compress((unsigned char *)page)) == 0)
+        return FALSE;
+
+    /* First fit */
+    n = (len + ZCHUNKSIZE - 1) / ZCHUNKSIZE;
+    start = 0;
+    run = 0;
+    for (i = 0; i < ZCHUNKS && run < n; i++)
+    {
+        if (zused[i])
+        {
+            start = i + 1;
+            run = 0;
+        }
+        else
+            run++;
+    }
+    if (run < n)
+    {
+        poolFailed(POOLZPOOL);
+        return FALSE;
+    }
+
+    for (i = start; i < start + n; i++)
+        zused[i] = TRUE;
+    memcopy(zpool + start * ZCHUNKSIZE, zbuf, len);
+    zstart[blk] = start;
+    zlen[blk] = len;
+
+    ps->ps_inUse += n;
+    if (ps->ps_inUse > ps->ps_highWater)
+        ps->ps_highWater = ps->ps_inUse;
+    return TRUE;
+}
+
+/**
+ * Decompresses swap block blk into the page at page, if the pool
+ * holds it. Returns FALSE if it does not: the block is on the flash.
+ */
+int zpoolLoad(int blk, memaddr page)
+{
+    if (zstart[blk] == NOCHUNK)
+        return FALSE;
+    decompress(zpool + zstart[blk] * ZCHUNKSIZE, zlen[blk], (unsigned char *)page);
+    return TRUE;
+}
+
+/**
+ * Drops the compressed copy of swap block blk, if any: the block has
+ * been freed.
+ */
+void zpoolFree(int blk)
+{
+    int n, i;
+
+    if (zstart[blk] == NOCHUNK)
+        return;
+    n = (zlen[blk] + ZCHUNKSIZE - 1) / ZCHUNKSIZE;
+    for (i = zstart[blk]; i < zstart[blk] + n; i++)
+        zused[i] = FALSE;
+    poolStats[POOLZPOOL].ps_inUse -= n;
+    zstart[blk] = NOCHUNK;
+}